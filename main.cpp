@@ -3,17 +3,44 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <random>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
 #include <ctime>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifdef _WIN32
   #include <windows.h>
 #endif
+#ifdef __linux__
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/mman.h>
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/syscall.h>
+  #include <sys/un.h>
+  #include <termios.h>
+  #include <unistd.h>
+#endif
 #ifdef __APPLE__
   #include <GLUT/glut.h>
   #include <OpenGL/glu.h>
@@ -34,33 +61,446 @@ static inline float dot(Vec2 a, Vec2 b){ return a.x*b.x + a.y*b.y; }
 static inline float length(Vec2 a){ return std::sqrt(dot(a,a)); }
 static inline Vec2 normalize(Vec2 a){ float L=length(a); return (L>1e-6f)? Vec2{a.x/L,a.y/L} : Vec2{1.f,0.f}; }
 
-static int scrW=900, scrH=700;
-static float nowSec(){ return glutGet(GLUT_ELAPSED_TIME)/1000.0f; }
-static std::mt19937 rng(1234567u);
-static std::uniform_real_distribution<float> u01(0.f,1.f);
+static int scrW=900, scrH=700;   // playfield; the simulation never sees the window size
+static int winW=900, winH=700;   // window, scaled onto the playfield
+static bool headless=false; // --headless: no window, GLUT is never initialised
+static float nowSec(){
+  if(headless){
+    static const auto t0 = std::chrono::steady_clock::now();
+    return std::chrono::duration<float>(std::chrono::steady_clock::now()-t0).count();
+  }
+  return glutGet(GLUT_ELAPSED_TIME)/1000.0f;
+}
+// Game state below is thread_local so whole games can run concurrently on
+// job workers (--serve); the GUI and headless paths only ever use one thread.
+static thread_local std::mt19937 rng(1234567u);
+static thread_local std::uniform_real_distribution<float> u01(0.f,1.f);
 
-// --- Drawing Functions for Modern Filled UI ---
+// --- Phase Profiler (wall time + optional hardware counters) ---
+// Each update/render phase is bracketed by perfMark(); the interval since the
+// previous mark is charged to the previous phase. With --perf on Linux the
+// cycles/instructions/cache-miss/branch-miss group is read at every mark via
+// perf_event_open, so layout changes can be judged by IPC and miss rates.
+enum Phase {
+  PH_PADDLE, PH_BALL_WALLS, PH_BRICKS, PH_PERKS, PH_BULLETS, PH_SCRIPTS, PH_WIN,
+  PH_R_BRICKS, PH_R_ENTITIES, PH_R_HUD, PH_R_SUBMIT, PH_COUNT, PH_NONE = -1
+};
+static const char* phaseNames[PH_COUNT] = {
+  "paddle", "ball+walls", "bricks", "perks", "bullets", "scripts", "win check",
+  "r:bricks", "r:entities", "r:hud", "r:submit"
+};
+enum { PC_CYCLES, PC_INSTR, PC_CACHE_MISS, PC_BRANCH_MISS, PC_COUNT };
+struct PhaseStats { double sec; uint64_t ctr[PC_COUNT]; uint64_t samples; };
 
-static void drawRectFilled(float cx,float cy,float w,float h){
-  float x0=cx-w/2.f, x1=cx+w/2.f, y0=cy-h/2.f, y1=cy+h/2.f;
-  glBegin(GL_QUADS);
-  glVertex2f(x0,y0); glVertex2f(x1,y0); glVertex2f(x1,y1); glVertex2f(x0,y1);
-  glEnd();
+static bool       perfEnabled=false;   // --perf
+static bool       showProfiler=false;  // F3 overlay
+static PhaseStats phaseStats[PH_COUNT];
+static int        perfPhase=PH_NONE;
+static int        perfFds[PC_COUNT]={-1,-1,-1,-1};
+static int        perfSlot[PC_COUNT]={-1,-1,-1,-1}; // index in the group read, -1 = unavailable
+static int        perfGroupSize=0;
+static uint64_t   perfLast[PC_COUNT];
+static std::chrono::steady_clock::time_point perfLastT;
+
+static bool perfReadCounters(uint64_t out[PC_COUNT]){
+#ifdef __linux__
+  if(perfGroupSize==0) return false;
+  uint64_t buf[1+PC_COUNT];
+  if(read(perfFds[PC_CYCLES], buf, sizeof(uint64_t)*(1+perfGroupSize)) <= 0) return false;
+  for(int c=0;c<PC_COUNT;c++) out[c] = (perfSlot[c]>=0) ? buf[1+perfSlot[c]] : 0;
+  return true;
+#else
+  (void)out; return false;
+#endif
 }
 
-static void drawCircleFilled(float cx,float cy,float r,int seg=32){
-  glBegin(GL_TRIANGLE_FAN);
-  glVertex2f(cx,cy);
-  for(int i=0;i<=seg;i++){ float th=(float)i*(float)(2.0*M_PI)/seg;
-    glVertex2f(cx+cosf(th)*r, cy+sinf(th)*r); }
-  glEnd();
+static void perfInit(){
+  perfEnabled = true;
+  std::memset(phaseStats, 0, sizeof(phaseStats));
+#ifdef __linux__
+  const uint64_t cfg[PC_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+  };
+  for(int c=0;c<PC_COUNT;c++){
+    perf_event_attr a; std::memset(&a, 0, sizeof(a));
+    a.size = sizeof(a); a.type = PERF_TYPE_HARDWARE; a.config = cfg[c];
+    a.disabled = (c==PC_CYCLES); a.exclude_kernel = 1; a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_GROUP;
+    int fd = (int)syscall(SYS_perf_event_open, &a, 0, -1, (c==PC_CYCLES)? -1 : perfFds[PC_CYCLES], 0);
+    if(fd < 0){ if(c==PC_CYCLES) break; continue; }  // no leader -> wall time only
+    perfFds[c] = fd; perfSlot[c] = perfGroupSize++;
+  }
+  if(perfGroupSize>0){
+    ioctl(perfFds[PC_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perfFds[PC_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  } else {
+    std::fprintf(stderr, "perf: hardware counters unavailable, reporting wall time only\n");
+  }
+#endif
+}
+
+static void perfMark(int next){
+  if(!perfEnabled) return;
+  uint64_t now[PC_COUNT] = {0,0,0,0};
+  bool hw = perfReadCounters(now);
+  auto t = std::chrono::steady_clock::now();
+  if(perfPhase!=PH_NONE){
+    PhaseStats& ps = phaseStats[perfPhase];
+    ps.sec += std::chrono::duration<double>(t - perfLastT).count();
+    if(hw) for(int c=0;c<PC_COUNT;c++) ps.ctr[c] += now[c] - perfLast[c];
+    ps.samples++;
+  }
+  if(hw) std::memcpy(perfLast, now, sizeof(perfLast));
+  perfLastT = t; perfPhase = next;
+}
+
+// One formatted row per phase: time per sample, cycles, IPC, misses per 1k instructions.
+static void perfFormatRow(int ph, char* buf, size_t n){
+  const PhaseStats& ps = phaseStats[ph];
+  double k = ps.samples ? 1.0/(double)ps.samples : 0.0;
+  if(perfSlot[PC_CYCLES] < 0){
+    std::snprintf(buf, n, "%-11s %8.2fus", phaseNames[ph], ps.sec*1e6*k); return;
+  }
+  double ins = (double)ps.ctr[PC_INSTR];
+  double ipc = ps.ctr[PC_CYCLES] ? ins/(double)ps.ctr[PC_CYCLES] : 0.0;
+  double cm  = ins>0 ? 1000.0*(double)ps.ctr[PC_CACHE_MISS]/ins : 0.0;
+  double bm  = ins>0 ? 1000.0*(double)ps.ctr[PC_BRANCH_MISS]/ins : 0.0;
+  std::snprintf(buf, n, "%-11s %8.2fus %9.0fcyc IPC %4.2f  $miss %5.2f/ki  br %5.2f/ki",
+                phaseNames[ph], ps.sec*1e6*k, (double)ps.ctr[PC_CYCLES]*k, ipc, cm, bm);
+}
+
+static void perfPrintSummary(FILE* f){
+  if(!perfEnabled) return;
+  std::fprintf(f, "phase profile (%s):\n", perfGroupSize ? "wall + hw counters" : "wall time");
+  char row[160];
+  for(int ph=0;ph<PH_COUNT;ph++){
+    if(!phaseStats[ph].samples) continue;
+    perfFormatRow(ph, row, sizeof(row)); std::fprintf(f, "  %s\n", row);
+  }
+}
+
+// --- Async Logger ---
+// LOG("perk applied type=%d", t) costs a clock read and a copy into the calling
+// thread's single-producer ring: no lock, no formatting, no I/O. A background
+// thread drains every ring, formats the records and appends them to a file
+// that rotates at LOG_ROTATE_BYTES. Formats must be string literals (only the
+// pointer is stored); %s arguments must be literals too. Full rings drop.
+union LogArg { long long i; double d; const char* s; };
+struct LogRecord { uint64_t ns; const char* fmt; uint8_t nargs; uint8_t kinds[4]; LogArg a[4]; };
+enum { LOG_INT, LOG_DBL, LOG_STR };
+
+struct LogRing {
+  static const size_t N = 4096;  // power of two
+  LogRecord rec[N];
+  std::atomic<size_t> head{0}, tail{0};   // head: producer, tail: consumer
+  std::atomic<uint64_t> dropped{0};
+};
+
+static const long     LOG_ROTATE_BYTES = 8L<<20;
+static bool           logEnabled=false;   // --log FILE
+static std::string    logPath;
+static std::mutex     logRingsMx;         // taken once per thread (registration) and by the drainer
+static std::vector<LogRing*> logRings;
+static std::atomic<bool> logRunning{false};
+static std::thread    logThread;
+static thread_local LogRing* logLocal = nullptr;
+
+static inline void logPut(LogRecord& r,int k,int v){ r.kinds[k]=LOG_INT; r.a[k].i=v; }
+static inline void logPut(LogRecord& r,int k,unsigned v){ r.kinds[k]=LOG_INT; r.a[k].i=v; }
+static inline void logPut(LogRecord& r,int k,long long v){ r.kinds[k]=LOG_INT; r.a[k].i=v; }
+static inline void logPut(LogRecord& r,int k,double v){ r.kinds[k]=LOG_DBL; r.a[k].d=v; }
+static inline void logPut(LogRecord& r,int k,const char* v){ r.kinds[k]=LOG_STR; r.a[k].s=v; }
+static inline void logPack(LogRecord&,int){}
+template <typename A, typename... Rest>
+static inline void logPack(LogRecord& r,int k,A a,Rest... rest){ logPut(r,k,a); logPack(r,k+1,rest...); }
+
+template <typename... Args>
+static inline void LOG(const char* fmt, Args... args){
+  static_assert(sizeof...(Args) <= 4, "LOG takes at most 4 arguments");
+  if(!logEnabled) return;
+  LogRing* q = logLocal;
+  if(!q){ q = logLocal = new LogRing(); std::lock_guard<std::mutex> g(logRingsMx); logRings.push_back(q); }
+  size_t h = q->head.load(std::memory_order_relaxed);
+  if(h - q->tail.load(std::memory_order_acquire) >= LogRing::N){ q->dropped.fetch_add(1, std::memory_order_relaxed); return; }
+  LogRecord& r = q->rec[h & (LogRing::N-1)];
+  r.ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  r.fmt = fmt; r.nargs = (uint8_t)sizeof...(Args);
+  logPack(r, 0, args...);
+  q->head.store(h+1, std::memory_order_release);
+}
+
+// Formats one record by feeding each conversion its own snprintf call, with
+// integer conversions widened to the stored long long.
+static size_t logFormat(const LogRecord& r,char* out,size_t cap){
+  size_t n = (size_t)std::snprintf(out, cap, "%12.6f ", r.ns*1e-9);
+  int k=0;
+  for(const char* p=r.fmt; *p && n+1<cap; ){
+    if(*p!='%'){ out[n++]=*p++; continue; }
+    if(p[1]=='%'){ out[n++]='%'; p+=2; continue; }
+    char spec[32]; size_t sl=0; spec[sl++]=*p++;
+    while(*p && std::strchr("-+ #0123456789.", *p) && sl<24) spec[sl++]=*p++;
+    while(*p && std::strchr("hlLqjzt", *p)) ++p;          // drop length modifiers
+    char conv = *p ? *p++ : 'd';
+    if(std::strchr("diuxXoc", conv)){ spec[sl++]='l'; spec[sl++]='l'; }
+    spec[sl++]=conv; spec[sl]=0;
+    int w = 0;
+    if(k < r.nargs){
+      const LogArg& a = r.a[k]; int kind = r.kinds[k++];
+      if(conv=='s')                        w = std::snprintf(out+n, cap-n, spec, kind==LOG_STR ? a.s : "?");
+      else if(std::strchr("fFgGeEaA",conv)) w = std::snprintf(out+n, cap-n, spec, kind==LOG_DBL ? a.d : (double)a.i);
+      else                                 w = std::snprintf(out+n, cap-n, spec, kind==LOG_DBL ? (long long)a.d : a.i);
+    }
+    if(w>0) n = std::min(cap-1, n+(size_t)w);
+  }
+  out[n++]='\n';
+  return n;
+}
+
+static void logDrainLoop(){
+  FILE* f = std::fopen(logPath.c_str(), "a");
+  long written = f ? std::ftell(f) : 0;
+  std::vector<LogRing*> rings; char line[512];
+  for(;;){
+    bool running = logRunning.load(std::memory_order_acquire);
+    { std::lock_guard<std::mutex> g(logRingsMx); rings = logRings; }
+    size_t drained = 0;
+    for(LogRing* q : rings){
+      size_t t = q->tail.load(std::memory_order_relaxed), h = q->head.load(std::memory_order_acquire);
+      for(; t!=h; ++t, ++drained){
+        size_t len = logFormat(q->rec[t & (LogRing::N-1)], line, sizeof(line));
+        if(f){ std::fwrite(line, 1, len, f); written += (long)len; }
+      }
+      q->tail.store(t, std::memory_order_release);
+      uint64_t lost = q->dropped.exchange(0, std::memory_order_relaxed);
+      if(lost && f) written += std::fprintf(f, "[log] dropped %llu records (ring full)\n", (unsigned long long)lost);
+    }
+    if(f && written >= LOG_ROTATE_BYTES){
+      std::fclose(f); std::rename(logPath.c_str(), (logPath+".1").c_str());
+      f = std::fopen(logPath.c_str(), "w"); written = 0;
+    }
+    if(!running && drained==0) break;
+    if(drained==0){ if(f) std::fflush(f); std::this_thread::sleep_for(std::chrono::milliseconds(2)); }
+  }
+  if(f) std::fclose(f);
+}
+
+static void logShutdown(){
+  if(!logRunning.exchange(false)) return;
+  logThread.join();
+}
+
+static void logStart(const std::string& path){
+  logPath = path; logEnabled = true; logRunning = true;
+  logThread = std::thread(logDrainLoop);
+  std::atexit(logShutdown);
+}
+
+// --- Job System ---
+// Work-stealing fork/join: every worker owns a Chase-Lev deque, pushes and
+// pops at the bottom, and steals from the top of others when empty. The
+// thread that calls jobInit() is worker 0; threads outside the pool submit
+// through a locked inject queue. jobWait() helps run jobs instead of
+// blocking. A JobCounter counts unfinished jobs; jobAfter() holds a job back
+// until a counter reaches zero (dependency edge). With --jobs 1 (default)
+// everything runs inline on the calling thread.
+struct JobCounter;
+struct Job { std::function<void()> fn; JobCounter* done; };
+
+struct JobCounter {
+  std::atomic<int> pending{0};
+  std::mutex mx; std::vector<Job*> waiting;   // jobs released when pending hits zero
+};
+
+struct JobDeque {
+  static const long N = 8192;  // power of two; outstanding jobs per worker
+  std::atomic<Job*> buf[N];
+  std::atomic<long> top{0}, bottom{0};
+  void push(Job* j){
+    long b = bottom.load(std::memory_order_relaxed);
+    buf[b & (N-1)].store(j, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b+1, std::memory_order_relaxed);
+  }
+  Job* pop(){
+    long b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long t = top.load(std::memory_order_relaxed);
+    if(t > b){ bottom.store(b+1, std::memory_order_relaxed); return nullptr; }
+    Job* j = buf[b & (N-1)].load(std::memory_order_relaxed);
+    if(t == b){
+      if(!top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed)) j = nullptr;
+      bottom.store(b+1, std::memory_order_relaxed);
+    }
+    return j;
+  }
+  Job* steal(){
+    long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long b = bottom.load(std::memory_order_acquire);
+    if(t >= b) return nullptr;
+    Job* j = buf[t & (N-1)].load(std::memory_order_relaxed);
+    if(!top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+    return j;
+  }
+};
+
+static int                      jobWorkers=1;       // --jobs N
+static std::vector<JobDeque*>   jobDeques;
+static std::vector<std::thread> jobThreads;
+static std::atomic<bool>        jobStop{false};
+static std::mutex               jobInjectMx;
+static std::vector<Job*>        jobInject;
+static thread_local int         jobIndex = -1;      // worker id, -1 outside the pool
+
+static void jobPush(Job* j){
+  if(jobIndex >= 0) jobDeques[jobIndex]->push(j);
+  else { std::lock_guard<std::mutex> g(jobInjectMx); jobInject.push_back(j); }
+}
+
+static Job* jobFind(){
+  if(jobIndex >= 0) if(Job* j = jobDeques[jobIndex]->pop()) return j;
+  int n = (int)jobDeques.size(), start = jobIndex>=0 ? jobIndex+1 : 0;
+  for(int k=0;k<n;k++){ int v=(start+k)%n; if(v!=jobIndex) if(Job* j = jobDeques[v]->steal()) return j; }
+  std::lock_guard<std::mutex> g(jobInjectMx);
+  if(jobInject.empty()) return nullptr;
+  Job* j = jobInject.back(); jobInject.pop_back(); return j;
+}
+
+static void jobExecute(Job* j){
+  j->fn();
+  JobCounter* c = j->done; delete j;
+  if(!c) return;
+  // Decrement under the counter's lock: jobWait() takes the same lock before
+  // returning, so a stack-allocated counter outlives our last touch of it.
+  std::vector<Job*> ready;
+  { std::lock_guard<std::mutex> g(c->mx);
+    if(c->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) ready.swap(c->waiting); }
+  for(Job* r : ready) jobPush(r);
+}
+
+static void jobWorkerLoop(int idx){
+  jobIndex = idx; int idle = 0;
+  while(!jobStop.load(std::memory_order_relaxed)){
+    if(Job* j = jobFind()){ jobExecute(j); idle = 0; continue; }
+    if(++idle < 64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+}
+
+static void jobShutdown(){
+  jobStop = true;
+  for(std::thread& t : jobThreads) t.join();
+  jobThreads.clear();
+}
+
+static void jobInit(int workers){
+  jobWorkers = std::max(1, workers);
+  for(int i=0;i<jobWorkers;i++) jobDeques.push_back(new JobDeque());
+  jobIndex = 0;
+  for(int i=1;i<jobWorkers;i++) jobThreads.emplace_back(jobWorkerLoop, i);
+  std::atexit(jobShutdown);
+}
+
+// Fork: run fn as a job counted in *done.
+static void jobRun(JobCounter* done, std::function<void()> fn){
+  if(jobWorkers<=1){ fn(); return; }
+  if(done) done->pending.fetch_add(1, std::memory_order_relaxed);
+  jobPush(new Job{std::move(fn), done});
+}
+
+// Dependency: run fn once *dep reaches zero.
+static void jobAfter(JobCounter* dep, JobCounter* done, std::function<void()> fn){
+  if(jobWorkers<=1){ fn(); return; }
+  if(done) done->pending.fetch_add(1, std::memory_order_relaxed);
+  Job* j = new Job{std::move(fn), done};
+  { std::lock_guard<std::mutex> g(dep->mx);
+    if(dep->pending.load(std::memory_order_acquire) > 0){ dep->waiting.push_back(j); return; } }
+  jobPush(j);
+}
+
+// Join: help with pending work until *c reaches zero.
+static void jobWait(JobCounter* c){
+  while(c->pending.load(std::memory_order_acquire) > 0){
+    if(Job* j = jobFind()) jobExecute(j); else std::this_thread::yield();
+  }
+  std::lock_guard<std::mutex> g(c->mx);
+}
+
+// Splits [0,n) into chunks of at least `grain` and runs fn(begin,end) on each.
+// Inside a whole-game job (jobSerial>0) it runs inline: helping in jobWait
+// could start another game on this thread and clobber its thread_local state.
+static thread_local int jobSerial = 0;
+static void parallelFor(int n,int grain,const std::function<void(int,int)>& fn){
+  if(jobWorkers<=1 || jobSerial>0 || n<=grain){ if(n>0) fn(0,n); return; }
+  JobCounter c;
+  for(int b=0;b<n;b+=grain){ int e=std::min(n,b+grain); jobRun(&c, [&fn,b,e]{ fn(b,e); }); }
+  jobWait(&c);
+}
+
+// --- Render Command List ---
+// renderScene() never talks to GL directly: it appends DrawCmds to a per-frame
+// list and presentFrame() hands that list to the active backend (the GLUT
+// window, the software rasterizer, the ANSI terminal, or the null backend
+// used by headless benchmarks). Bricks are a single DRAW_BRICK_LAYER command when the brick
+// cache is on; backends keep a retained layer and patch only dirty bricks.
+// DRAW_QUADS submits the whole quadBatch (the --arena tiles) in one call.
+enum DrawOp { DRAW_RECT, DRAW_OUTLINE, DRAW_CIRCLE, DRAW_TEXT, DRAW_PERK_ICON, DRAW_BRICK_LAYER, DRAW_THUMB, DRAW_QUADS };
+struct DrawCmd {
+  DrawOp op; float x,y,w,h; float r,g,b;
+  int   arg;   // circle segments, perk type, thumbnail index, or index into DrawList::strings
+  void* font;  // DRAW_TEXT only
+};
+enum Backend { BACKEND_GL, BACKEND_SOFT, BACKEND_NULL, BACKEND_TERM };
+
+static Backend                  backend = BACKEND_GL;
+struct DrawList { std::vector<DrawCmd> cmds; std::vector<std::string> strings; float r=1.f, g=1.f, b=1.f; };
+
+static DrawList frameList;                          // what presentFrame() submits
+static thread_local DrawList* drawTarget = &frameList; // parallel render jobs emit into their own list
+static float clearR=0.f, clearG=0.f, clearB=0.f;
+static long long framesPresented=0, cmdsPresented=0;
+
+// Level thumbnails written by --thumbs: one RGB atlas (rows top-down, as in
+// the PPM file) and the top-left corner of every tile. --atlas loads it for
+// the menu so previews are one texture instead of live level renders.
+struct ThumbAtlas { int w=0, h=0, tw=0, th=0; std::vector<uint8_t> rgb; std::vector<int> x, y; };
+static ThumbAtlas thumbAtlas;
+
+// Axis-aligned quads in window pixels, four corners each starting at (x0,y0)
+// with (x1,y1) third, colour as 0xAABBGGRR (GL_UNSIGNED_BYTE RGBA order).
+struct QuadVertex { float x, y; uint32_t rgba; };
+static std::vector<QuadVertex> quadBatch;
+
+static void beginFrame(float r,float g,float b){
+  frameList.cmds.clear(); frameList.strings.clear();
+  clearR=r; clearG=g; clearB=b;
+}
+static void setColor(float r,float g,float b){ drawTarget->r=r; drawTarget->g=g; drawTarget->b=b; }
+static void pushCmd(DrawOp op,float x,float y,float w,float h,int arg=0,void* font=nullptr){
+  DrawList& L = *drawTarget;
+  DrawCmd c; c.op=op; c.x=x; c.y=y; c.w=w; c.h=h; c.r=L.r; c.g=L.g; c.b=L.b; c.arg=arg; c.font=font;
+  L.cmds.push_back(c);
+}
+// Appends a list produced by a render job, keeping text indices valid.
+static void appendDrawList(DrawList& dst,const DrawList& src){
+  size_t base = dst.strings.size();
+  dst.strings.insert(dst.strings.end(), src.strings.begin(), src.strings.end());
+  for(DrawCmd c : src.cmds){ if(c.op==DRAW_TEXT) c.arg += (int)base; dst.cmds.push_back(c); }
 }
 
+// --- Drawing Functions for Modern Filled UI ---
+
+static void drawRectFilled(float cx,float cy,float w,float h){ pushCmd(DRAW_RECT, cx,cy,w,h); }
+static void drawRectOutline(float cx,float cy,float w,float h){ pushCmd(DRAW_OUTLINE, cx,cy,w,h); }
+static void drawCircleFilled(float cx,float cy,float r,int seg=32){ pushCmd(DRAW_CIRCLE, cx,cy,r,r, seg); }
 static void drawText(float x,float y,const std::string& s, void* font=GLUT_BITMAP_HELVETICA_18){
-  glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
-  glRasterPos2f(x,y); for(size_t i=0;i<s.size();++i) glutBitmapCharacter(font, s[i]);
-  glPopMatrix();
+  drawTarget->strings.push_back(s); pushCmd(DRAW_TEXT, x,y,0.f,0.f, (int)drawTarget->strings.size()-1, font);
 }
+static void drawPerkIcon(int type,float x,float y,float s){ pushCmd(DRAW_PERK_ICON, x,y,s,s, type); }
+static void drawThumb(int level,float cx,float cy,float w,float h){ pushCmd(DRAW_THUMB, cx,cy,w,h, level); }
+static void drawQuadBatch(){ pushCmd(DRAW_QUADS, 0.f,0.f,0.f,0.f); }
 
 // --- Game Structures and State ---
 enum Screen { MENU, PLAY, PAUSE, HELP, HIGHSCORES, WIN, GAMEOVER };
@@ -69,615 +509,4549 @@ enum PerkType {
   THROUGH_BALL, FIREBALL, INSTANT_DEATH, SHOOTING_PADDLE
 };
 
-struct Brick { float x,y,w,h; bool alive; int hp; float r,g,b; int score; };
+struct Brick {
+  float x,y,w,h; bool alive; int hp; float r,g,b; int score;
+  int type;       // index into brickTypes; 0 is the plain, unscripted brick
+  float var[4];   // script state v0-v3
+};
 struct Perk  { Vec2 pos, vel; float size; PerkType type; bool alive; };
 struct Bullet{ Vec2 pos, vel; float w,h; bool alive; };
 
+// Timed effects (through, fireball, width, shooting) live on the effect wheel.
+static const int BALL_CONTACTS = 8;
 struct Ball {
   Vec2 pos, vel; float speed, radius;
   bool stuck;
-  bool through; float throughTimer;
-  bool fireball; float fireballTimer;
+  bool through;
+  bool fireball;
+  int contacts[BALL_CONTACTS], nContacts;  // bricks touched last tick (contact cache)
 };
 struct Paddle {
   Vec2 pos; float w,h; float speed;
-  float widthTimer;
-  bool shooting; float shootingTimer;
+  bool shooting;
 };
 
-static Screen current = MENU;
-static std::vector<Brick>  bricks;
-static std::vector<Perk>   perks;
-static std::vector<Bullet> bullets;
-static Ball    ball;
-static Paddle paddle;
-static int     lives=3, score=0;
-static float   startTime=0.f, playTime=0.f, lastTick=0.f;
-static bool    leftHeld=false, rightHeld=false, hasLaunched=false;
-static bool    canResume=false;
+static thread_local Screen current = MENU;
+static thread_local std::vector<Brick>  bricks;
+static thread_local int bricksAlive=0;      // live entries in bricks
+static thread_local std::vector<Perk>   perks;
+static thread_local std::vector<Bullet> bullets;
+static thread_local Ball    ball;
+static thread_local Paddle paddle;
+static thread_local int     lives=3, score=0;
+static thread_local float   startTime=0.f, playTime=0.f;   // playTime: simulated seconds (sum of tick dts)
+static thread_local bool    leftHeld=false, rightHeld=false, hasLaunched=false;
+static thread_local bool    canResume=false;
 static int     menuIndex=0;
-static float   globalSpeedGain=0.f;
+static thread_local float   globalSpeedGain=0.f;
+
+// Multi-rate update: speed regain, effect timers and perks change slowly, so
+// with --slow-rate N they run once per N wheel ticks (FX_TICK) of simulated
+// time, stepped by the time accumulated since their last run; the ball,
+// paddle and bullets keep every tick. Falling perks are drawn extrapolated by
+// slowAccum so they still move every frame. N=1 is the exact per-tick update
+// that replays and bench baselines were recorded with; a replay only
+// reproduces under the rate it was recorded at, so replays carry their rate
+// and re-simulation runs at it (replayRate) whatever --slow-rate says.
+static int slowRate = 1;
+static thread_local int replayRate = 0;      // nonzero while re-simulating a replay
+static thread_local float slowAccum = 0.f;   // simulated time the slow subsystems have not seen yet
+
+// Gameplay constants the tuner (--tune) may change, per thread so candidates
+// can be simulated side by side. Perks are rolled in perkRoll order: the
+// first cut above the roll picks the perk, INSTANT_DEATH takes the rest.
+struct Tuning {
+  float perkChance = 0.22f;   // per destroyed brick
+  float perkCut[7] = {0.18f, 0.36f, 0.52f, 0.66f, 0.78f, 0.90f, 0.96f};
+  float gainRate = 2.f;       // speed regained after a lost life, per second
+  float speedRate = 4.f;      // live ball speed-up, per second
+};
+static thread_local Tuning tuning;
+static const PerkType perkRoll[8] = {EXTRA_LIFE, SPEED_UP, WIDE_PADDLE, SHRINK_PADDLE, THROUGH_BALL, FIREBALL, SHOOTING_PADDLE, INSTANT_DEATH};
+static inline int perkRollIndex(float r){ int k=0; while(k<7 && r>=tuning.perkCut[k]) ++k; return k; }
 
 static bool    haveBest=false; static int bestScore=0; static float bestTime=0.f;
 static int     pauseMenuIndex = 0; // 0 = Resume, 1 = Exit to Menu
 
 // In-memory run history (no file I/O)
 struct Run { float t; int s; };
-static std::vector<Run> history;
+static thread_local std::vector<Run> history;
 static const int MAX_LIVES = 5;
 
-static void saveHighScore(){
-  history.push_back({playTime, score});
-}
-static void loadBest(){
-  haveBest = false; bestScore = 0; bestTime = 0.f;
-  for(const auto& r : history){
-    if(!haveBest || r.s > bestScore || (r.s == bestScore && r.t < bestTime)){
-      haveBest = true; bestScore = r.s; bestTime = r.t;
-    }
-  }
+// Brick layouts (see Level Packs) and scripted brick types (see Brick Scripts)
+struct Level { std::string name; int rows=0, cols=0; std::string cells; };
+enum { EV_HIT, EV_TICK, EV_DESTROY, EV_COUNT };
+struct ScriptHandler { int entry=-1; uint32_t writes=0; int locals=0; };  // entry in scriptCode, fields assigned, local count
+struct BrickType { char cell=0; int colour=0, hp=1; ScriptHandler on[EV_COUNT]; };
+static std::vector<BrickType> brickTypes(1);   // [0] = plain brick; the rest come from the level pack
+static thread_local std::vector<int> tickBricks;   // bricks whose type has on_tick
+static const int LEVEL_MAX_ROWS = 16, LEVEL_MAX_COLS = 32;
+static std::vector<Level> levelPack;  // --pack FILE
+static int levelIndex = -1;           // pack level the next game starts on; -1 = built-in layout
+
+// --- Effect Timer Wheel ---
+// Timed effects are keyed by (kind, target entity) and scheduled on a
+// hierarchical timing wheel driven by simulation time: three levels of 64
+// slots of FX_TICK each cover about 36 minutes. Effects hang off intrusive
+// per-slot lists with an occupancy mask per level, so adding, refreshing and
+// cancelling are O(1), a tick with nothing due is a mask test, and an expiry
+// costs O(1) plus at most two cascades. fxExpire() is the per-kind callback.
+enum FxKind  { FX_THROUGH, FX_FIREBALL, FX_WIDTH, FX_SHOOTING, FX_KINDS };
+enum FxRule  {
+  FX_REPLACE,   // remaining := d
+  FX_REFRESH,   // remaining := max(remaining, d)
+  FX_EXTEND,    // remaining += d
+  FX_STACK      // stacks += 1, remaining := max(remaining, d)
+};
+static const float FX_TICK = 1.f/120.f;
+static const int   FX_BITS = 6, FX_SLOTS = 1<<FX_BITS, FX_LEVELS = 3;
+static const uint32_t FX_SPAN = 1u<<(FX_BITS*FX_LEVELS);
+
+struct Effect { int kind, target, stacks; uint32_t due; int prev, next, slot; };
+static thread_local std::vector<Effect> fxPool;
+static thread_local std::vector<int>    fxFree;
+static thread_local int      fxHead[FX_LEVELS*FX_SLOTS];
+static thread_local uint64_t fxMask[FX_LEVELS];
+static thread_local uint32_t fxNow=0; static thread_local float fxAccum=0.f;
+static thread_local std::unordered_map<uint64_t,int> fxIndex;  // (kind,target) -> pool index
+static thread_local uint32_t fxVersion=0;   // bumped on every structural change (state forking shares unchanged wheels)
+static void fxExpire(int kind, int target, int stacks);
+
+static inline uint64_t fxKey(int kind,int target){ return ((uint64_t)(uint32_t)kind<<32) | (uint32_t)target; }
+
+static void fxLink(int i){
+  Effect& e = fxPool[i]; ++fxVersion;
+  uint32_t d = e.due - fxNow; int lvl = 0;
+  while(lvl < FX_LEVELS-1 && d >= (1u<<(FX_BITS*(lvl+1)))) lvl++;
+  int s = lvl*FX_SLOTS + (int)((e.due >> (FX_BITS*lvl)) & (FX_SLOTS-1));
+  e.slot=s; e.prev=-1; e.next=fxHead[s];
+  if(e.next>=0) fxPool[e.next].prev=i;
+  fxHead[s]=i; fxMask[lvl] |= 1ull<<(s & (FX_SLOTS-1));
 }
 
-static void resetBallOnPaddle(){
-  ball.stuck=true; hasLaunched=false;
-  ball.through=false; ball.throughTimer=0.f;
-  ball.fireball=false; ball.fireballTimer=0.f;
-  ball.speed = 320.f + globalSpeedGain;
-  ball.pos = {paddle.pos.x, paddle.pos.y + paddle.h/2.f + ball.radius + 1.f};
-  ball.vel = {0.f, 1.f};
+static void fxUnlink(int i){
+  Effect& e = fxPool[i]; ++fxVersion;
+  if(e.prev>=0) fxPool[e.prev].next=e.next; else fxHead[e.slot]=e.next;
+  if(e.next>=0) fxPool[e.next].prev=e.prev;
+  if(fxHead[e.slot]<0) fxMask[e.slot/FX_SLOTS] &= ~(1ull<<(e.slot & (FX_SLOTS-1)));
+  e.slot=-1;
 }
 
-static void buildBricks(int rows=7,int cols=12){
-  bricks.clear();
-  float marginX=70.f, marginY=100.f, gap=6.f;
-  float areaW = scrW - 2*marginX;
-  float bw = (areaW - (cols-1)*gap)/cols;
-  float bh = 22.f;
+static void fxClear(){
+  fxPool.clear(); fxFree.clear(); fxIndex.clear();
+  std::fill(fxHead, fxHead+FX_LEVELS*FX_SLOTS, -1); std::fill(fxMask, fxMask+FX_LEVELS, 0ull);
+  fxNow=0; fxAccum=0.f; ++fxVersion;
+}
 
-  float colors[7][3] = {
-    {0.9f, 0.2f, 0.4f}, {0.9f, 0.6f, 0.1f}, {0.9f, 0.9f, 0.2f},
-    {0.2f, 0.8f, 0.4f}, {0.2f, 0.6f, 0.9f}, {0.5f, 0.3f, 0.9f},
-    {0.8f, 0.8f, 0.8f}
-  };
+static uint32_t fxTicks(float sec){
+  float t = std::ceil(sec/FX_TICK - 1e-3f);
+  return t < 1.f ? 1u : t >= (float)(FX_SPAN-1) ? FX_SPAN-1 : (uint32_t)t;
+}
 
-  for(int r=0;r<rows;r++){
-    for(int c=0;c<cols;c++){
-      Brick b;
-      b.x = marginX + c*(bw+gap) + bw/2.f;
-      b.y = scrH - marginY - r*(bh+gap) - bh/2.f;
-      b.w=bw; b.h=bh; b.alive=true; b.hp = (r<2?2:1);
-      b.r = colors[r % 7][0]; b.g = colors[r % 7][1]; b.b = colors[r % 7][2];
-      b.score = 50 + 10*r;
-      bricks.push_back(b);
-    }
+// Starts or re-applies (kind,target) for sec seconds under rule.
+static void fxApply(int kind, int target, float sec, FxRule rule){
+  std::unordered_map<uint64_t,int>::iterator it = fxIndex.find(fxKey(kind,target));
+  if(it == fxIndex.end()){
+    int i; if(!fxFree.empty()){ i=fxFree.back(); fxFree.pop_back(); } else { i=(int)fxPool.size(); fxPool.push_back(Effect()); }
+    Effect& e = fxPool[i]; e.kind=kind; e.target=target; e.stacks=1; e.due=fxNow+fxTicks(sec);
+    fxIndex[fxKey(kind,target)]=i; fxLink(i); return;
+  }
+  int i = it->second; Effect& e = fxPool[i];
+  uint32_t left = e.due - fxNow, d = fxTicks(sec), due = e.due;
+  switch(rule){
+    case FX_REPLACE: due = fxNow + d; break;
+    case FX_REFRESH: if(d > left) due = fxNow + d; break;
+    case FX_EXTEND:  due = fxNow + std::min(left + d, FX_SPAN-1); break;
+    case FX_STACK:   e.stacks++; ++fxVersion; if(d > left) due = fxNow + d; break;
   }
+  if(due != e.due){ fxUnlink(i); e.due=due; fxLink(i); }
 }
 
-static void newGame(){
-  score=0; lives=3; globalSpeedGain=0.f; perks.clear(); bullets.clear();
-  paddle.pos={scrW/2.f, 48.f}; paddle.w=120.f; paddle.h=16.f;
-  paddle.speed=630.f; paddle.widthTimer=0.f; paddle.shooting=false; paddle.shootingTimer=0.f;
-  ball.radius=9.f; ball.speed=320.f; ball.stuck=true; ball.through=false; ball.fireball=false;
-  resetBallOnPaddle();
-  buildBricks();
-  startTime = nowSec(); lastTick=startTime; playTime=0.f;
-  current=PLAY; canResume=true;
+static void fxCancel(int kind, int target){
+  std::unordered_map<uint64_t,int>::iterator it = fxIndex.find(fxKey(kind,target));
+  if(it == fxIndex.end()) return;
+  fxUnlink(it->second); fxFree.push_back(it->second); fxIndex.erase(it);
 }
 
-// Exit to main menu handler: clear play-state and return to menu
-static void exitToMenu(){
-  perks.clear(); bullets.clear();
-  // reset some gameplay state
-  bricks.clear();
-  score = 0;
-  lives = 3;
-  globalSpeedGain = 0.f;
-  paddle.pos = {scrW/2.f, 48.f}; paddle.w = 120.f; paddle.h = 16.f;
-  ball.radius = 9.f; ball.speed = 320.f;
-  resetBallOnPaddle();
-  canResume = false;
-  current = MENU;
-  pauseMenuIndex = 0;
+static float fxRemaining(int kind, int target){
+  std::unordered_map<uint64_t,int>::const_iterator it = fxIndex.find(fxKey(kind,target));
+  return it == fxIndex.end() ? 0.f : (fxPool[it->second].due - fxNow)*FX_TICK - fxAccum;
 }
 
-static void maybeSpawnPerk(const Brick& b){
-  float p=0.22f; if(u01(rng)<p){
-    Perk pk; pk.pos={b.x,b.y}; pk.vel={0,-150.f}; pk.size=18.f; pk.alive=true;
-    float r=u01(rng);
-    if(r<0.18f) pk.type=EXTRA_LIFE;
-    else if(r<0.36f) pk.type=SPEED_UP;
-    else if(r<0.52f) pk.type=WIDE_PADDLE;
-    else if(r<0.66f) pk.type=SHRINK_PADDLE;
-    else if(r<0.78f) pk.type=THROUGH_BALL;
-    else if(r<0.90f) pk.type=FIREBALL;
-    else if(r<0.96f) pk.type=SHOOTING_PADDLE;
-    else pk.type=INSTANT_DEATH;
-    perks.push_back(pk);
+// Seconds until the next expiry. Level 0 is exact; upper levels contribute
+// the time of their next cascade, a lower bound. 1e30 when nothing is scheduled.
+static float fxNextDue(){
+  float best = 1e30f;
+  for(int lvl=0; lvl<FX_LEVELS; lvl++){
+    uint64_t m = fxMask[lvl]; if(!m) continue;
+    int sh = FX_BITS*lvl; uint32_t next = (fxNow>>sh) + 1; int c = (int)(next & (FX_SLOTS-1));
+    uint64_t rot = c ? (m>>c) | (m<<(FX_SLOTS-c)) : m;
+    uint32_t at = (next + (uint32_t)__builtin_ctzll(rot)) << sh;
+    best = std::min(best, (at - fxNow)*FX_TICK - fxAccum);
   }
+  return best;
 }
 
-static void applyPerk(PerkType t){
-  switch(t){
-    case EXTRA_LIFE:      lives = (lives<MAX_LIVES? lives+1:MAX_LIVES); break;
-    case SPEED_UP:        ball.speed *= 1.18f;                     break;
-    case WIDE_PADDLE:     paddle.w = (paddle.w*1.35f<320.f? paddle.w*1.35f:320.f); paddle.widthTimer=14.f; break;
-    case SHRINK_PADDLE:   paddle.w = (paddle.w*0.7f>60.f?  paddle.w*0.7f:60.f);  paddle.widthTimer=12.f; break;
-    case THROUGH_BALL:    ball.through=true; ball.throughTimer=10.f; break;
-    case FIREBALL:        ball.fireball=true; ball.fireballTimer=8.f; ball.through=true; if(ball.throughTimer<8.f) ball.throughTimer=8.f; break;
-    case INSTANT_DEATH:   lives = 0; current=GAMEOVER; saveHighScore(); canResume=false; break;
-    case SHOOTING_PADDLE: paddle.shooting=true; paddle.shootingTimer=12.f; break;
+static void fxCascade(int lvl){
+  int s = lvl*FX_SLOTS + (int)((fxNow >> (FX_BITS*lvl)) & (FX_SLOTS-1));
+  for(int i=fxHead[s]; i>=0; ){ int n=fxPool[i].next; fxUnlink(i); fxLink(i); i=n; }
+}
+
+// Advances the wheel by dt of simulation time and fires what falls due.
+static void fxAdvance(float dt){
+  fxAccum += dt;
+  int n = (int)(fxAccum/FX_TICK + 1e-3f); if(n <= 0) return;
+  fxAccum -= n*FX_TICK; if(fxAccum < 0.f) fxAccum = 0.f;
+  for(; n>0; n--){
+    if(!(fxMask[0] | fxMask[1] | fxMask[2])){ fxNow += (uint32_t)n; return; }
+    fxNow++;
+    if((fxNow & (FX_SLOTS-1))==0){
+      if(((fxNow>>FX_BITS) & (FX_SLOTS-1))==0) fxCascade(2);
+      fxCascade(1);
+    }
+    int s = (int)(fxNow & (FX_SLOTS-1));
+    while(fxHead[s]>=0){
+      int i=fxHead[s]; Effect e=fxPool[i];
+      fxUnlink(i); fxFree.push_back(i); fxIndex.erase(fxKey(e.kind,e.target));
+      fxExpire(e.kind, e.target, e.stacks);
+    }
   }
 }
-// Collision detection: Axis-Aligned Bounding Box (AABB) vs Circle
-static bool aabbCircleCollision(float rx,float ry,float rw,float rh, Vec2 c,float r, Vec2* nrm,float* pen){
-  float cx = clampv(c.x, rx-rw/2.f, rx+rw/2.f);
-  float cy = clampv(c.y, ry-rh/2.f, ry+rh/2.f);
-  float dx = c.x - cx, dy = c.y - cy;
-  float d2 = dx*dx + dy*dy; if(d2 > r*r) return false;
-  float d = std::sqrt(d2<1e-6f?1e-6f:d2);
-  if(nrm){ if(d>1e-4f) *nrm = {dx/d, dy/d}; else *nrm = {0.f,1.f}; }
-  if(pen) *pen = r - d;
-  return true;
+
+// --- Shared-Memory Metrics ---
+// --shm NAME publishes live state to a POSIX shared-memory segment
+// (/dev/shm/NAME) under a seqlock: the game makes seq odd, writes the payload
+// and makes seq even again; a reader copies the payload and retries if seq
+// was odd or moved. Publishing is plain stores (no syscalls, no locks), and a
+// reader can poll at any rate without touching the game. --monitor NAME is
+// such a reader.
+struct MetricsPayload {
+  int32_t  screen, score, lives, effects;
+  float    playTime, ballSpeed;
+  uint32_t bricksAlive, perks, bullets, pad;
+  float    frameP50us, frameP99us, frameMaxus, pad2;
+  uint64_t frames;
+  uint64_t ballBrickTests, paddleTests, perkTests, bulletTests;  // narrowphase tests so far
+};
+struct MetricsSegment {
+  uint32_t magic, version;
+  std::atomic<uint32_t> seq;
+  uint32_t pid;              // writer's pid; 0 once it has exited
+  MetricsPayload m;
+};
+static const uint32_t METRICS_MAGIC = 0x4d425844u;  // "DXBM"
+static MetricsSegment* metricsSeg = nullptr;
+static thread_local uint64_t statBallBrickTests=0, statPaddleTests=0, statPerkTests=0, statBulletTests=0;
+static float    metricsFrameUs[256];
+static uint64_t metricsFrames=0;
+static float    metricsP50=0.f, metricsP99=0.f, metricsMax=0.f;
+
+static std::string metricsName(const std::string& name){ return name[0]=='/' ? name : "/"+name; }
+
+static void metricsShutdown(){
+#ifdef __linux__
+  if(metricsSeg){ metricsSeg->pid = 0; munmap(metricsSeg, sizeof(MetricsSegment)); metricsSeg = nullptr; }
+#endif
 }
-static void reflectBall(Vec2 n){
-  Vec2 v=ball.vel; float sp=length(v); if(sp<1e-6f) return;
-  Vec2 dir = v*(1.f/sp);
-  Vec2 r   = dir - n*(2.f*dot(dir,n));
-  ball.vel = normalize(r) * ball.speed;
+
+static bool metricsStart(const std::string& name){
+#ifdef __linux__
+  int fd = shm_open(metricsName(name).c_str(), O_CREAT|O_RDWR, 0644);
+  if(fd < 0){ std::perror("shm_open"); return false; }
+  if(ftruncate(fd, sizeof(MetricsSegment)) != 0){ std::perror("ftruncate"); close(fd); return false; }
+  void* p = mmap(nullptr, sizeof(MetricsSegment), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(p == MAP_FAILED){ std::perror("mmap"); return false; }
+  metricsSeg = new (p) MetricsSegment();
+  metricsSeg->magic = METRICS_MAGIC; metricsSeg->version = 1; metricsSeg->pid = (uint32_t)getpid();
+  std::atexit(metricsShutdown);
+  return true;
+#else
+  std::fprintf(stderr, "--shm: shared-memory metrics are only supported on Linux\n"); (void)name;
+  return false;
+#endif
 }
 
-static void loseLife(){
-  if(lives > 0) lives--;
-  if(lives <= 0){
-    lives = 0;
-    current=GAMEOVER; saveHighScore(); canResume=false;
-  } else {
-    paddle.pos.x = scrW/2.f; paddle.w=120.f; paddle.widthTimer=0.f; paddle.shooting=false; paddle.shootingTimer=0.f;
-    resetBallOnPaddle();
+// Frame (or headless tick) duration; percentiles refresh every 256 frames.
+static void metricsFrame(double sec){
+  metricsFrameUs[metricsFrames & 255] = (float)(sec*1e6); ++metricsFrames;
+  if((metricsFrames & 255)==0){
+    float v[256]; std::memcpy(v, metricsFrameUs, sizeof(v));
+    std::nth_element(v, v+128, v+256); metricsP50 = v[128];
+    std::nth_element(v, v+253, v+256); metricsP99 = v[253];
+    metricsMax = *std::max_element(v+253, v+256);
   }
 }
 
-static void fireBullet(){
-  if(!paddle.shooting) return;
-  Bullet b; b.pos={paddle.pos.x, paddle.pos.y + paddle.h/2.f + 8.f}; b.vel={0,640.f}; b.w=4.f; b.h=10.f; b.alive=true;
-  bullets.push_back(b);
+static void metricsPublish(){
+  MetricsSegment* s = metricsSeg; if(!s) return;
+  uint32_t q = s->seq.load(std::memory_order_relaxed);
+  s->seq.store(q+1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  MetricsPayload& m = s->m;
+  m.screen = (int32_t)current; m.score = score; m.lives = lives; m.effects = (int32_t)fxIndex.size();
+  m.playTime = playTime; m.ballSpeed = ball.speed;
+  m.bricksAlive = (uint32_t)bricksAlive;   // dead perks and bullets stay in their vectors until the next game
+  m.perks   = (uint32_t)std::count_if(perks.begin(), perks.end(), [](const Perk& p){ return p.alive; });
+  m.bullets = (uint32_t)std::count_if(bullets.begin(), bullets.end(), [](const Bullet& b){ return b.alive; });
+  m.frameP50us = metricsP50; m.frameP99us = metricsP99; m.frameMaxus = metricsMax;
+  m.frames = metricsFrames;
+  m.ballBrickTests = statBallBrickTests; m.paddleTests = statPaddleTests;
+  m.perkTests = statPerkTests; m.bulletTests = statBulletTests;
+  s->seq.store(q+2, std::memory_order_release);
 }
 
-// --- Game Logic Update ---
-static void updateGame(float dt){
-  // Update Timers and Speed
-  globalSpeedGain += dt*2.f; ball.speed += dt*4.f;
-  if(ball.through){ ball.throughTimer -= dt; if(ball.throughTimer<=0){ ball.through=false; } }
-  if(ball.fireball){ ball.fireballTimer -= dt; if(ball.fireballTimer<=0){ ball.fireball=false; } }
-  if(paddle.widthTimer>0){ paddle.widthTimer -= dt; if(paddle.widthTimer<=0){ paddle.widthTimer=0; paddle.w=120.f; } }
-  if(paddle.shooting){ paddle.shootingTimer -= dt; if(paddle.shootingTimer<=0){ paddle.shooting=false; } }
+static bool metricsRead(const MetricsSegment* s, MetricsPayload& out){
+  for(int tries=0; tries<10000; tries++){
+    uint32_t a = s->seq.load(std::memory_order_acquire);
+    if(a & 1) continue;
+    std::memcpy(&out, (const void*)&s->m, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(s->seq.load(std::memory_order_relaxed) == a) return true;
+  }
+  return false;
+}
 
-  // Update Paddle Movement
-  float vx=0.f; if(leftHeld) vx -= paddle.speed; if(rightHeld) vx += paddle.speed;
-  paddle.pos.x += vx*dt;
-  paddle.pos.x = clampv(paddle.pos.x, paddle.w/2.f+6.f, scrW - paddle.w/2.f - 6.f);
+// Prints the segment twice a second until the writer exits or goes quiet for 5s.
+static int runMonitor(const std::string& name){
+#ifdef __linux__
+  int fd = shm_open(metricsName(name).c_str(), O_RDONLY, 0);
+  if(fd < 0){ std::perror("shm_open"); return 1; }
+  void* p = mmap(nullptr, sizeof(MetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(p == MAP_FAILED){ std::perror("mmap"); return 1; }
+  const MetricsSegment* s = (const MetricsSegment*)p;
+  if(s->magic != METRICS_MAGIC){ std::fprintf(stderr, "monitor: %s is not a metrics segment\n", name.c_str()); return 1; }
+  static const char* screens[] = {"MENU","PLAY","PAUSE","HELP","HIGHSCORES","WIN","GAMEOVER"};
+  uint64_t lastFrames = ~0ull; int quiet = 0;
+  while(s->pid != 0 && quiet < 10){
+    MetricsPayload m;
+    if(metricsRead(s, m)){
+      std::printf("%-10s score=%d lives=%d t=%.1fs bricks=%u perks=%u bullets=%u fx=%d speed=%.0f "
+                  "frame p50/p99/max=%.1f/%.1f/%.1fus tests brick/paddle/perk/bullet=%llu/%llu/%llu/%llu frames=%llu\n",
+                  (m.screen>=0 && m.screen<7) ? screens[m.screen] : "?", m.score, m.lives, m.playTime,
+                  m.bricksAlive, m.perks, m.bullets, m.effects, m.ballSpeed, m.frameP50us, m.frameP99us, m.frameMaxus,
+                  (unsigned long long)m.ballBrickTests, (unsigned long long)m.paddleTests,
+                  (unsigned long long)m.perkTests, (unsigned long long)m.bulletTests, (unsigned long long)m.frames);
+      std::fflush(stdout);
+      quiet = m.frames==lastFrames ? quiet+1 : 0; lastFrames = m.frames;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  }
+  munmap(p, sizeof(MetricsSegment));
+  return 0;
+#else
+  std::fprintf(stderr, "--monitor: shared-memory metrics are only supported on Linux\n"); (void)name;
+  return 1;
+#endif
+}
 
-  // Update Ball Movement
-  if(ball.stuck){
-    ball.pos.x = paddle.pos.x;
-    ball.pos.y = paddle.pos.y + paddle.h/2.f + ball.radius + 1.f;
-  } else {
-    ball.pos = ball.pos + ball.vel*dt;
+// --- Input Recording and Replays ---
+// Every gameplay input goes through playerInput() so a game can be replayed
+// exactly: a replay is the game's rng seed, the dt of every PLAY tick, and
+// the input events tagged with the tick they arrived before. A finished game
+// also carries its claimed result (final score and playTime) and a hash
+// chain: every REPLAY_CHAIN_TICKS ticks, just before the tick runs, a digest
+// of the game is folded into the previous link (the first into the seed).
+// --verify re-simulates a replay and checks all three; DXR1 files have none.
+// A game recorded under --slow-rate N>1 ends with a trailer: "RATE", then N.
+enum InputKind { IN_LEFT, IN_RIGHT, IN_PADDLE_X, IN_LAUNCH_KEY, IN_LAUNCH_MOUSE, IN_FIRE };
+struct InputEvent { uint32_t tick; uint8_t kind; float value; };
+struct Replay {
+  uint32_t seed=0; std::vector<float> dts; std::vector<InputEvent> events;
+  bool claimed=false; int32_t score=0; float playTime=0.f; std::vector<uint64_t> chain;
+  int32_t rate=1;   // --slow-rate the game was played at
+};
+static const uint32_t REPLAY_CHAIN_TICKS = 120;
+static const uint32_t REPLAY_RATE_TAG = 0x45544152u;  // "RATE"
+static const float    REPLAY_MAX_DT = 0.03f;   // interactive ticks are clamped to [0, this]
 
-    // Wall reflection
-    if(ball.pos.x - ball.radius < 0){ ball.pos.x = ball.radius; ball.vel.x = std::fabs(ball.vel.x); }
-    if(ball.pos.x + ball.radius > scrW){ ball.pos.x = scrW - ball.radius; ball.vel.x = -std::fabs(ball.vel.x); }
-    if(ball.pos.y + ball.radius > scrH){ ball.pos.y = scrH - ball.radius; ball.vel.y = -std::fabs(ball.vel.y); }
+static thread_local Replay recording;   // the game in progress, always kept in memory
+static std::string recordDir;   // --record DIR: also write each finished game to disk
+static int         recordedRuns=0;
+static thread_local bool branchSim=false;   // lookahead branch (see State Forking): game ends are not recorded
+static thread_local bool resimulating=false; // --verify re-simulation: nor are these, but heatmaps count them
+static int checkEvery=0;                    // --check N (see Invariant Checker)
+static thread_local Replay checkPrev;       // the previous game's recording, kept while checking
+static thread_local uint64_t checkGame=0;   // games begun, while checking
+static void checkTick(); static void checkFinish();
 
-    // Bottom boundary (lose life)
-    if(ball.pos.y - ball.radius < 0){ loseLife(); return; }
+static void beginRecording(uint32_t seed){
+  if(checkEvery){ std::swap(checkPrev, recording); ++checkGame; }
+  recording.seed = seed; recording.dts.clear(); recording.events.clear();
+  recording.claimed = false; recording.chain.clear(); recording.rate = slowRate;
+}
 
-    // Paddle Collision
-    Vec2 n; float pen;
-    if(aabbCircleCollision(paddle.pos.x,paddle.pos.y,paddle.w,paddle.h, ball.pos, ball.radius, &n,&pen)){
-      ball.pos = ball.pos + n*pen;
-      // Angle reflection based on hit position
-      float rel = (ball.pos.x - paddle.pos.x) / (paddle.w/2.f); rel = clampv(rel,-1.f,1.f);
-      Vec2 dir = normalize(Vec2{rel, 1.2f});
-      ball.vel = dir * ball.speed; ball.vel.y = std::fabs(ball.vel.y);
-    }
+// Bit-exact digest of the simulation state, folded into link h.
+static uint64_t replayLink(uint64_t h){
+  auto mix = [&h](uint64_t v){ h = (h ^ v) * 0x9e3779b97f4a7c15ull; h ^= h >> 29; };
+  auto bits = [](float f){ uint32_t u; std::memcpy(&u, &f, 4); return (uint64_t)u; };
+  mix((uint64_t)(uint32_t)score << 32 | (uint32_t)lives); mix((uint64_t)(uint32_t)bricksAlive << 32 | (uint32_t)current);
+  mix(bits(ball.pos.x) << 32 | bits(ball.pos.y)); mix(bits(ball.vel.x) << 32 | bits(ball.vel.y));
+  mix(bits(ball.speed) << 32 | bits(paddle.pos.x)); mix(bits(paddle.w) << 32 | bits(playTime));
+  for(size_t i=0;i<bricks.size();++i) if(bricks[i].alive) mix((uint64_t)i << 32 | (uint32_t)bricks[i].hp);
+  return h;
+}
 
-    // Brick Collision
-    for(size_t i=0;i<bricks.size();++i){
-      Brick& b = bricks[i]; if(!b.alive) continue;
-      Vec2 bn; float bpen;
-      if(aabbCircleCollision(b.x,b.y,b.w,b.h, ball.pos, ball.radius, &bn,&bpen)){
-        int before=b.hp; b.hp-=1; score += b.score;
-        if(before>0 && b.hp<=0){ b.alive=false; maybeSpawnPerk(b); }
-        if(!(ball.through || ball.fireball)){ ball.pos = ball.pos + bn*bpen; reflectBall(bn); }
-      }
-    }
-  }
+static void recordTick(float dt){
+  if(recording.dts.size() % REPLAY_CHAIN_TICKS == 0) recording.chain.push_back(replayLink(recording.chain.empty() ? recording.seed : recording.chain.back()));
+  recording.dts.push_back(dt);
+}
 
-  // Perk Movement and Collection
-  for(size_t i=0;i<perks.size();++i){
-    Perk& p=perks[i]; if(!p.alive) continue;
-    p.pos = p.pos + p.vel*dt;
-    if(p.pos.y < -30.f){ p.alive=false; continue; }
-    if(std::fabs(p.pos.x - paddle.pos.x) <= (paddle.w/2.f + p.size/2.f) &&
-       std::fabs(p.pos.y - paddle.pos.y) <= (paddle.h/2.f + p.size/2.f)){
-      p.alive=false; applyPerk(p.type); if(lives<=0){ return; }
-    }
+static bool saveReplay(const std::string& path, const Replay& r){
+  FILE* f = std::fopen(path.c_str(), "wb"); if(!f) return false;
+  uint32_t hdr[4] = {r.claimed ? 0x32525844u /* "DXR2" */ : 0x31525844u /* "DXR1" */, r.seed, (uint32_t)r.dts.size(), (uint32_t)r.events.size()};
+  std::fwrite(hdr, sizeof(hdr), 1, f);
+  if(!r.dts.empty()) std::fwrite(r.dts.data(), sizeof(float), r.dts.size(), f);
+  for(const InputEvent& e : r.events){
+    std::fwrite(&e.tick, 4, 1, f); std::fwrite(&e.kind, 1, 1, f); std::fwrite(&e.value, 4, 1, f);
   }
+  if(r.claimed){
+    uint32_t n = (uint32_t)r.chain.size();
+    std::fwrite(&r.score, 4, 1, f); std::fwrite(&r.playTime, 4, 1, f); std::fwrite(&n, 4, 1, f);
+    if(n) std::fwrite(r.chain.data(), sizeof(uint64_t), n, f);
+  }
+  if(r.rate != 1){ uint32_t t[2] = {REPLAY_RATE_TAG, (uint32_t)r.rate}; std::fwrite(t, sizeof(t), 1, f); }
+  return std::fclose(f)==0;
+}
 
-  // Bullet Movement and Collision
-  for(size_t i=0;i<bullets.size();++i){
-    Bullet& bu = bullets[i]; if(!bu.alive) continue;
-    bu.pos = bu.pos + bu.vel*dt;
-    if(bu.pos.y > scrH+20.f){ bu.alive=false; continue; }
-    for(size_t j=0;j<bricks.size();++j){
-      Brick& br = bricks[j]; if(!br.alive) continue;
-      if(std::fabs(bu.pos.x - br.x) <= (br.w/2.f) && std::fabs(bu.pos.y - br.y) <= (br.h/2.f)){
-        bu.alive=false; int before=br.hp; br.hp-=1; score += br.score;
-        if(before>0 && br.hp<=0){ br.alive=false; maybeSpawnPerk(br); }
-        break;
-      }
+static bool loadReplay(const std::string& path, Replay& r){
+  FILE* f = std::fopen(path.c_str(), "rb"); if(!f) return false;
+  uint32_t hdr[4]; bool ok = std::fread(hdr, sizeof(hdr), 1, f)==1 && (hdr[0]==0x31525844u || hdr[0]==0x32525844u);
+  if(ok){
+    r.seed = hdr[1]; r.dts.resize(hdr[2]); r.events.resize(hdr[3]);
+    ok = r.dts.empty() || std::fread(r.dts.data(), sizeof(float), r.dts.size(), f)==r.dts.size();
+    for(size_t i=0; ok && i<r.events.size(); i++){
+      InputEvent& e = r.events[i];
+      ok = std::fread(&e.tick,4,1,f)==1 && std::fread(&e.kind,1,1,f)==1 && std::fread(&e.value,4,1,f)==1;
     }
+    r.claimed = hdr[0]==0x32525844u; r.chain.clear();
+    uint32_t n = 0;
+    if(ok && r.claimed) ok = std::fread(&r.score,4,1,f)==1 && std::fread(&r.playTime,4,1,f)==1 && std::fread(&n,4,1,f)==1 && n <= r.dts.size()/REPLAY_CHAIN_TICKS+1;
+    if(ok && n){ r.chain.resize(n); ok = std::fread(r.chain.data(), sizeof(uint64_t), n, f)==n; }
+    uint32_t t[2]; r.rate = 1;
+    if(ok && std::fread(t, sizeof(t), 1, f)==1){ ok = t[0]==REPLAY_RATE_TAG && t[1]>=2 && t[1]<=16; r.rate = (int32_t)t[1]; }
   }
+  std::fclose(f);
+  return ok;
+}
+
+static void saveHighScore(){
+  if(branchSim || resimulating) return;
+  history.push_back({playTime, score});
+  recording.claimed = true; recording.score = score; recording.playTime = playTime;
+  if(!recordDir.empty() && levelIndex<0){   // a replay holds only the seed, so it implies the built-in layout
+    char name[64]; std::snprintf(name, sizeof(name), "/run_%u_%03d.dxr", recording.seed, recordedRuns++);
+    if(!saveReplay(recordDir+name, recording)) std::fprintf(stderr, "record: cannot write %s%s\n", recordDir.c_str(), name);
+  }
+}
+static void loadBest(){
+  haveBest = false; bestScore = 0; bestTime = 0.f;
+  for(const auto& r : history){
+    if(!haveBest || r.s > bestScore || (r.s == bestScore && r.t < bestTime)){
+      haveBest = true; bestScore = r.s; bestTime = r.t;
+    }
+  }
+}
+
+static void resetBallOnPaddle(){
+  ball.stuck=true; hasLaunched=false; ball.nContacts=0;
+  ball.through=false;  fxCancel(FX_THROUGH, 0);
+  ball.fireball=false; fxCancel(FX_FIREBALL, 0);
+  ball.speed = 320.f + globalSpeedGain;
+  ball.pos = {paddle.pos.x, paddle.pos.y + paddle.h/2.f + ball.radius + 1.f};
+  ball.vel = {0.f, 1.f};
+}
+
+// Bricks whose hp/alive changed since the brick layer was last presented.
+static bool             brickCache=true;        // --no-brick-cache draws every brick every frame
+static thread_local bool brickLayerStale=true;   // layer must be rebuilt from scratch
+static thread_local std::vector<int> dirtyBricks;
+static void markBrickDirty(size_t i){ dirtyBricks.push_back((int)i); }
+
+// Brick pages written since the game was last captured or restored (see
+// State Forking); forkSynced is cleared whenever the brick table is rebuilt.
+static const int STATE_BRICK_PAGE = 16;
+static thread_local std::vector<uint64_t> brickTouched;
+static thread_local bool forkSynced=false;
+static inline void touchBrick(int i){
+  size_t p = (size_t)i/STATE_BRICK_PAGE;
+  if(p/64 >= brickTouched.size()) brickTouched.resize(p/64+1, 0ull);
+  brickTouched[p/64] |= 1ull<<(p%64);
+}
+
+// --- Heatmaps ---
+// --heatmap PREFIX counts three things over every game a run simulates
+// (headless, --batch, --verify; lookahead branches are skipped):
+// - where the ball enters a brick contact (a 2-D grid),
+// - where it is lost past the bottom (a histogram over x),
+// - where falling perks are missed (a histogram over x).
+// Each thread counts into its own fixed-size HeatGrid. A grid is allocated
+// on the thread's first count and pushed onto a lock-free list, so a count
+// costs a flag test and an increment. heatFinish() sums the list once the
+// run's workers are idle and writes PREFIX.heat (raw counts) and one PGM
+// per layer.
+static const int HEAT_CELL = 10, HEAT_W = 90, HEAT_H = 70;   // the 900x700 playfield in 10px cells
+struct HeatGrid { uint32_t impact[HEAT_H*HEAT_W], death[HEAT_W], perkMiss[HEAT_W]; HeatGrid* next; };
+static bool heatOn = false;
+static std::string heatPrefix;
+static std::atomic<HeatGrid*> heatList(nullptr);
+static thread_local HeatGrid* heatLocal = nullptr;
+
+static HeatGrid* heatAttach(){
+  HeatGrid* g = new HeatGrid(); g->next = heatList.load(std::memory_order_relaxed);
+  while(!heatList.compare_exchange_weak(g->next, g, std::memory_order_release, std::memory_order_relaxed)) {}
+  return heatLocal = g;
+}
+static inline int heatX(float x){ return clampv((int)(x/HEAT_CELL), 0, HEAT_W-1); }
+static inline int heatY(float y){ return clampv((int)(y/HEAT_CELL), 0, HEAT_H-1); }
+static inline HeatGrid* heatGrid(){ return heatLocal ? heatLocal : heatAttach(); }
+static inline void heatImpact(float x,float y){ if(heatOn && !branchSim) heatGrid()->impact[heatY(y)*HEAT_W + heatX(x)]++; }
+static inline void heatDeath(float x){ if(heatOn && !branchSim) heatGrid()->death[heatX(x)]++; }
+static inline void heatPerkMiss(float x){ if(heatOn && !branchSim) heatGrid()->perkMiss[heatX(x)]++; }
+
+// log(1+n) scaled so the busiest cell is white.
+static inline uint8_t heatShade(uint32_t n, double lmax){ return lmax>0 ? (uint8_t)std::lround(255.0*std::log1p((double)n)/lmax) : 0; }
+
+static bool heatWritePGM(const std::string& path, int w, int h, const std::vector<uint8_t>& px){
+  FILE* f = std::fopen(path.c_str(), "wb"); if(!f) return false;
+  bool ok = std::fprintf(f, "P5\n%d %d\n255\n", w, h) > 0 && std::fwrite(px.data(), 1, px.size(), f)==px.size();
+  return std::fclose(f)==0 && ok;
+}
+
+// Histogram image: one 4px column per cell, bar height by log count.
+static bool heatWriteBars(const std::string& path, const uint32_t* n){
+  const int S = 4, H = 100;
+  double lmax = std::log1p((double)*std::max_element(n, n+HEAT_W));
+  std::vector<uint8_t> px((size_t)HEAT_W*S*H, 0);
+  for(int x=0;x<HEAT_W;x++){
+    int bar = (int)std::lround(H*(lmax>0 ? std::log1p((double)n[x])/lmax : 0.0));
+    for(int y=H-bar;y<H;y++) std::memset(&px[(size_t)y*HEAT_W*S + x*S], 255, S-1);
+  }
+  return heatWritePGM(path, HEAT_W*S, H, px);
+}
+
+static bool heatFinish(long long games){
+  if(!heatOn) return true;
+  HeatGrid sum; std::memset(&sum, 0, sizeof(sum));
+  int threads = 0;
+  for(HeatGrid* g = heatList.load(std::memory_order_acquire); g; g = g->next, threads++){
+    for(int i=0;i<HEAT_H*HEAT_W;i++) sum.impact[i] += g->impact[i];
+    for(int i=0;i<HEAT_W;i++){ sum.death[i] += g->death[i]; sum.perkMiss[i] += g->perkMiss[i]; }
+  }
+  bool ok = true;
+  FILE* f = std::fopen((heatPrefix+".heat").c_str(), "wb");
+  if(f){
+    uint32_t hdr[5] = {0x31485844u /* "DXH1" */, (uint32_t)HEAT_CELL, (uint32_t)HEAT_W, (uint32_t)HEAT_H, 0};
+    uint64_t ng = (uint64_t)games;
+    ok = std::fwrite(hdr, sizeof(hdr), 1, f)==1 && std::fwrite(&ng, 8, 1, f)==1 &&
+         std::fwrite(sum.impact, 4, HEAT_H*HEAT_W, f)==(size_t)HEAT_H*HEAT_W &&
+         std::fwrite(sum.death, 4, HEAT_W, f)==(size_t)HEAT_W && std::fwrite(sum.perkMiss, 4, HEAT_W, f)==(size_t)HEAT_W;
+    ok = std::fclose(f)==0 && ok;
+  } else ok = false;
+
+  const int S = 4;   // impact map: 4px per cell, top of the playfield at the top
+  double lmax = std::log1p((double)*std::max_element(sum.impact, sum.impact+HEAT_H*HEAT_W));
+  std::vector<uint8_t> px((size_t)HEAT_W*S*HEAT_H*S);
+  for(int y=0;y<HEAT_H*S;y++) for(int x=0;x<HEAT_W*S;x++)
+    px[(size_t)y*HEAT_W*S + x] = heatShade(sum.impact[(HEAT_H-1-y/S)*HEAT_W + x/S], lmax);
+  ok = heatWritePGM(heatPrefix+"_impact.pgm", HEAT_W*S, HEAT_H*S, px) && ok;
+  ok = heatWriteBars(heatPrefix+"_death.pgm", sum.death) && ok;
+  ok = heatWriteBars(heatPrefix+"_perkmiss.pgm", sum.perkMiss) && ok;
+
+  uint64_t nImpact=0, nDeath=0, nMiss=0;
+  for(int i=0;i<HEAT_H*HEAT_W;i++) nImpact += sum.impact[i];
+  for(int i=0;i<HEAT_W;i++){ nDeath += sum.death[i]; nMiss += sum.perkMiss[i]; }
+  std::printf("heatmap: %lld games, %llu impacts, %llu deaths, %llu missed perks from %d thread grids -> %s.heat/_impact/_death/_perkmiss.pgm%s\n",
+              games, (unsigned long long)nImpact, (unsigned long long)nDeath, (unsigned long long)nMiss, threads, heatPrefix.c_str(), ok ? "" : " (write failed)");
+  return ok;
+}
+
+// --- Brick Broadphase ---
+// Uniform grid over the playfield. Each cell lists the live bricks touching
+// it in ascending index order, so walking candidates visits bricks in the
+// same order as a full scan. Bricks leave the grid when destroyed.
+static const float GRID_CELL = 48.f;
+static thread_local int gridCols=0, gridRows=0;
+static thread_local std::vector<std::vector<int>> gridCells;
+
+static inline int gridCellX(float x){ return clampv((int)std::floor(x/GRID_CELL), 0, gridCols-1); }
+static inline int gridCellY(float y){ return clampv((int)std::floor(y/GRID_CELL), 0, gridRows-1); }
+
+static void gridBuild(){
+  gridCols = std::max(1, (int)std::ceil(scrW/GRID_CELL)); gridRows = std::max(1, (int)std::ceil(scrH/GRID_CELL));
+  gridCells.assign((size_t)gridCols*gridRows, std::vector<int>());
+  for(size_t i=0;i<bricks.size();++i){
+    const Brick& b = bricks[i]; if(!b.alive) continue;
+    for(int cy=gridCellY(b.y-b.h/2.f); cy<=gridCellY(b.y+b.h/2.f); cy++)
+      for(int cx=gridCellX(b.x-b.w/2.f); cx<=gridCellX(b.x+b.w/2.f); cx++)
+        gridCells[(size_t)cy*gridCols+cx].push_back((int)i);
+  }
+}
+
+static void gridRemove(int i){
+  const Brick& b = bricks[i];
+  for(int cy=gridCellY(b.y-b.h/2.f); cy<=gridCellY(b.y+b.h/2.f); cy++)
+    for(int cx=gridCellX(b.x-b.w/2.f); cx<=gridCellX(b.x+b.w/2.f); cx++){
+      std::vector<int>& c = gridCells[(size_t)cy*gridCols+cx];
+      std::vector<int>::iterator it = std::lower_bound(c.begin(), c.end(), i);
+      if(it!=c.end() && *it==i) c.erase(it);
+    }
+}
+
+static void gridInsert(int i){
+  const Brick& b = bricks[i];
+  for(int cy=gridCellY(b.y-b.h/2.f); cy<=gridCellY(b.y+b.h/2.f); cy++)
+    for(int cx=gridCellX(b.x-b.w/2.f); cx<=gridCellX(b.x+b.w/2.f); cx++){
+      std::vector<int>& c = gridCells[(size_t)cy*gridCols+cx];
+      c.insert(std::lower_bound(c.begin(), c.end(), i), i);
+    }
+}
+
+// Live bricks whose cells touch [x0,x1] x [y0,y1], sorted and unique.
+static void gridQuery(float x0,float y0,float x1,float y1,std::vector<int>& out){
+  out.clear();
+  if(gridCells.empty()) return;
+  int cx0=gridCellX(x0), cx1=gridCellX(x1), cy0=gridCellY(y0), cy1=gridCellY(y1);
+  for(int cy=cy0; cy<=cy1; cy++) for(int cx=cx0; cx<=cx1; cx++){
+    const std::vector<int>& c = gridCells[(size_t)cy*gridCols+cx];
+    out.insert(out.end(), c.begin(), c.end());
+  }
+  if(cx0!=cx1 || cy0!=cy1){ std::sort(out.begin(), out.end()); out.erase(std::unique(out.begin(), out.end()), out.end()); }
+}
+
+// The calling thread's grid and brick table, for lookups made from pool
+// workers (whose own thread_local grid is some other game's, or empty).
+struct GridView { const std::vector<int>* cells; int cols, rows; const Brick* bricks; };
+static GridView gridView(){ return {gridCells.empty() ? nullptr : gridCells.data(), gridCols, gridRows, bricks.data()}; }
+
+// First live brick with index >= from containing point (x,y), or -1.
+static int gridFirstAt(const GridView& g,float x,float y,int from){
+  if(!g.cells) return -1;
+  int cx = clampv((int)std::floor(x/GRID_CELL), 0, g.cols-1), cy = clampv((int)std::floor(y/GRID_CELL), 0, g.rows-1);
+  const std::vector<int>& c = g.cells[(size_t)cy*g.cols+cx];
+  for(std::vector<int>::const_iterator it = std::lower_bound(c.begin(), c.end(), from); it!=c.end(); ++it){
+    const Brick& b = g.bricks[*it];
+    if(b.alive && std::fabs(x - b.x) <= (b.w/2.f) && std::fabs(y - b.y) <= (b.h/2.f)) return *it;
+  }
+  return -1;
+}
+static int gridFirstAt(float x,float y,int from){ return gridFirstAt(gridView(), x, y, from); }
+
+// --- Brick Scripts ---
+// Brick types declared in a level pack may carry event handlers:
+//   brick <cell a-z> <colour 1-7> <hp>
+//   on_hit                       (or on_tick, on_destroy)
+//     <statements>
+//   end
+// Statements are `name = expr`, `if expr` / `else` / `end`, and `spawn expr`
+// (drop perk type 0-7 at the brick). Expressions have numbers, names, ( ),
+// unary - and `not`, * /, + -, comparisons, `and`, `or`; true is 1, false 0.
+// Names are the brick's fields (hp x y r g b v0-v3 writable; w h read-only),
+// the globals dt time ballx bally, `damage` (on_hit: the damage about to be
+// dealt; the handler may change it) and locals, created on first assignment.
+//
+// Handlers compile to a register VM: 32-bit instructions (op, a, b, c) over
+// 256 float registers. A brick's fields live in fixed registers, copied in
+// before a handler and validated on the way out, so no instruction touches
+// game state. Registers 64 and up hold the pack's constants, loaded once per
+// batch of handlers, so literals are plain operands and need no load
+// instruction. Jumps only go forward, so a handler runs at most its own
+// length; the VM never allocates (spawns are queued in a fixed array).
+enum ScriptReg {
+  SR_HP, SR_X, SR_Y, SR_R, SR_G, SR_B, SR_V0, SR_V1, SR_V2, SR_V3, SR_W, SR_H,
+  SR_DT, SR_TIME, SR_BALLX, SR_BALLY, SR_DAMAGE, SR_FIXED,
+  SR_LOCALS = 20, SR_TEMPS = 40, SR_CONSTS = 64, SR_COUNT = 256
+};
+static const char* scriptRegNames[SR_FIXED] = {
+  "hp","x","y","r","g","b","v0","v1","v2","v3","w","h","dt","time","ballx","bally","damage"
+};
+enum ScriptOp {
+  OP_RET, OP_MOV, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_LT, OP_LE, OP_EQ, OP_NE,
+  OP_AND, OP_OR, OP_NEG, OP_NOT, OP_JZ, OP_JMP, OP_SPAWN
+};
+static const int SCRIPT_MAX_SPAWN = 4;
+static std::vector<uint32_t> scriptCode;     // every handler of the pack, each ending in OP_RET
+static std::vector<float>    scriptConsts;    // registers SR_CONSTS.. at run time
+static thread_local long long scriptOps=0, scriptRuns=0;
+
+static inline uint32_t scriptIns(int op,int a,int b=0,int c=0){ return (uint32_t)op | (uint32_t)a<<8 | (uint32_t)b<<16 | (uint32_t)c<<24; }
+
+// Compiles one handler a line at a time; line() returns false with err set.
+struct ScriptCompiler {
+  std::vector<std::string> tok; size_t t=0;
+  std::vector<std::string> locals;
+  std::vector<int> ifs;      // per open `if`: the pending forward jump to patch
+  int temp=SR_TEMPS, entry=-1; uint32_t writes=0;
+  std::string err;
+
+  bool fail(const std::string& m){ if(err.empty()) err=m; return false; }
+  void begin(){ locals.clear(); ifs.clear(); entry=(int)scriptCode.size(); writes=0; }
+  ScriptHandler handler() const { ScriptHandler h; h.entry=entry; h.writes=writes; h.locals=(int)locals.size(); return h; }
+  bool lex(const std::string& s){
+    tok.clear(); t=0;
+    for(size_t i=0;i<s.size();){
+      char c=s[i];
+      if(c==' ' || c=='\t'){ i++; continue; }
+      size_t j=i;
+      if(std::isalpha((unsigned char)c) || c=='_'){ while(j<s.size() && (std::isalnum((unsigned char)s[j]) || s[j]=='_')) j++; }
+      else if(std::isdigit((unsigned char)c) || c=='.'){ while(j<s.size() && (std::isdigit((unsigned char)s[j]) || s[j]=='.')) j++; }
+      else if((c=='<' || c=='>' || c=='=' || c=='!') && i+1<s.size() && s[i+1]=='=') j=i+2;
+      else if(std::strchr("+-*/()<>=", c)) j=i+1;
+      else return fail(std::string("unexpected '")+c+"'");
+      tok.push_back(s.substr(i, j-i)); i=j;
+    }
+    return true;
+  }
+  bool at(const char* s) const { return t<tok.size() && tok[t]==s; }
+  int reg(const std::string& name, bool write){
+    for(int i=0;i<SR_FIXED;i++) if(name==scriptRegNames[i]){
+      if(write && (i==SR_W || i==SR_H || (i>=SR_DT && i<SR_DAMAGE))){ fail(name+" is read-only"); return -1; }
+      return i;
+    }
+    for(size_t i=0;i<locals.size();i++) if(locals[i]==name) return SR_LOCALS+(int)i;
+    if(!write){ fail("unknown name "+name); return -1; }
+    if(locals.size() >= (size_t)(SR_TEMPS-SR_LOCALS)){ fail("too many locals"); return -1; }
+    locals.push_back(name); return SR_LOCALS+(int)locals.size()-1;
+  }
+  int newTemp(){ if(temp>=SR_CONSTS){ fail("expression too complex"); return -1; } return temp++; }
+  int binary(int op,int l,int r){
+    if(l<0 || r<0) return -1;
+    int d = newTemp(); if(d<0) return -1;
+    scriptCode.push_back(scriptIns(op, d, l, r)); return d;
+  }
+  int primary(){
+    if(t>=tok.size()){ fail("expression expected"); return -1; }
+    const std::string& k = tok[t++];
+    if(k=="("){ int r=orExpr(); if(!at(")")){ fail("')' expected"); return -1; } t++; return r; }
+    if(k=="-"){ return binary(OP_NEG, primary(), 0); }
+    if(k=="not"){ return binary(OP_NOT, primary(), 0); }
+    if(std::isdigit((unsigned char)k[0]) || k[0]=='.'){
+      float v = std::strtof(k.c_str(), nullptr);
+      for(size_t i=0;i<scriptConsts.size();i++) if(scriptConsts[i]==v) return SR_CONSTS+(int)i;
+      if(scriptConsts.size() >= (size_t)(SR_COUNT-SR_CONSTS)){ fail("more than 192 distinct constants"); return -1; }
+      scriptConsts.push_back(v); return SR_CONSTS+(int)scriptConsts.size()-1;
+    }
+    if(std::isalpha((unsigned char)k[0]) || k[0]=='_') return reg(k, false);
+    fail("unexpected "+k); return -1;
+  }
+  int term(){
+    int l=primary();
+    while(at("*") || at("/")){ int op = tok[t++]=="*" ? OP_MUL : OP_DIV; l = binary(op, l, primary()); }
+    return l;
+  }
+  int sum(){
+    int l=term();
+    while(at("+") || at("-")){ int op = tok[t++]=="+" ? OP_ADD : OP_SUB; l = binary(op, l, term()); }
+    return l;
+  }
+  int cmp(){
+    int l=sum();
+    if(at("<") || at("<=") || at(">") || at(">=") || at("==") || at("!=")){
+      std::string o = tok[t++]; int r = sum();
+      if(o=="<")  return binary(OP_LT, l, r);
+      if(o=="<=") return binary(OP_LE, l, r);
+      if(o==">")  return binary(OP_LT, r, l);
+      if(o==">=") return binary(OP_LE, r, l);
+      return binary(o=="==" ? OP_EQ : OP_NE, l, r);
+    }
+    return l;
+  }
+  int andExpr(){ int l=cmp(); while(at("and")){ t++; l = binary(OP_AND, l, cmp()); } return l; }
+  int orExpr(){ int l=andExpr(); while(at("or")){ t++; l = binary(OP_OR, l, andExpr()); } return l; }
+  bool patch(int at){
+    int off = (int)scriptCode.size() - at;
+    if(off > 65535) return fail("handler too long");
+    scriptCode[at] = (scriptCode[at] & 0xFFFFu) | (uint32_t)off<<16;
+    return true;
+  }
+  int expr(){ int r=orExpr(); if(r>=0 && t<tok.size()){ fail("unexpected "+tok[t]); return -1; } return r; }
+  // Returns false on error; *done is set when the handler's closing `end` is read.
+  bool line(const std::string& s, bool* done){
+    *done=false; temp=SR_TEMPS;
+    if(!lex(s)) return false;
+    if(tok.empty()) return true;
+    if(tok[0]=="end" && tok.size()==1){
+      if(ifs.empty()){ scriptCode.push_back(scriptIns(OP_RET,0)); *done=true; return true; }
+      bool ok = patch(ifs.back()); ifs.pop_back(); return ok;
+    }
+    if(tok[0]=="else" && tok.size()==1){
+      if(ifs.empty()) return fail("else without if");
+      scriptCode.push_back(scriptIns(OP_JMP,0)); int j=(int)scriptCode.size()-1;
+      if(!patch(ifs.back())) return false;
+      ifs.back()=j; return true;
+    }
+    if(tok[0]=="if"){
+      t=1; int c=expr(); if(c<0) return false;
+      scriptCode.push_back(scriptIns(OP_JZ, c)); ifs.push_back((int)scriptCode.size()-1); return true;
+    }
+    if(tok[0]=="spawn"){
+      t=1; int c=expr(); if(c<0) return false;
+      scriptCode.push_back(scriptIns(OP_SPAWN, c)); return true;
+    }
+    if(tok.size()>=3 && tok[1]=="="){
+      t=2; int v=expr(); if(v<0) return false;
+      int d=reg(tok[0], true); if(d<0) return false;
+      if(d<SR_FIXED) writes |= 1u<<d;
+      // The value is usually the temp the last instruction just wrote: retarget it.
+      uint32_t last = scriptCode.empty() ? 0 : scriptCode.back();
+      if(v>=SR_TEMPS && v<SR_CONSTS && (last&255)>=OP_MOV && (last&255)<=OP_NOT && (int)((last>>8)&255)==v)
+        scriptCode.back() = (scriptCode.back() & ~0xFF00u) | (uint32_t)d<<8;
+      else scriptCode.push_back(scriptIns(OP_MOV, d, v));
+      return true;
+    }
+    return fail("statement expected");
+  }
+};
+
+static void scriptLoadConsts(float* R){ std::copy(scriptConsts.begin(), scriptConsts.end(), R+SR_CONSTS); }
+
+static void scriptExec(int pc, float* R, int* spawn, int& nSpawn){
+  const uint32_t* code = scriptCode.data();
+  long long ops=0;
+  for(;;){
+    uint32_t in = code[pc++]; ++ops;
+    int a = (in>>8)&255, b = (in>>16)&255, c = (int)(in>>24);
+    switch(in & 255){
+      case OP_RET:   scriptOps += ops; return;
+      case OP_MOV:   R[a] = R[b]; break;
+      case OP_ADD:   R[a] = R[b] + R[c]; break;
+      case OP_SUB:   R[a] = R[b] - R[c]; break;
+      case OP_MUL:   R[a] = R[b] * R[c]; break;
+      case OP_DIV:   R[a] = R[c]!=0.f ? R[b] / R[c] : 0.f; break;
+      case OP_LT:    R[a] = R[b] <  R[c] ? 1.f : 0.f; break;
+      case OP_LE:    R[a] = R[b] <= R[c] ? 1.f : 0.f; break;
+      case OP_EQ:    R[a] = R[b] == R[c] ? 1.f : 0.f; break;
+      case OP_NE:    R[a] = R[b] != R[c] ? 1.f : 0.f; break;
+      case OP_AND:   R[a] = (R[b]!=0.f && R[c]!=0.f) ? 1.f : 0.f; break;
+      case OP_OR:    R[a] = (R[b]!=0.f || R[c]!=0.f) ? 1.f : 0.f; break;
+      case OP_NEG:   R[a] = -R[b]; break;
+      case OP_NOT:   R[a] = R[b]==0.f ? 1.f : 0.f; break;
+      case OP_JZ:    if(R[a]==0.f) pc += (int)(in>>16) - 1; break;
+      case OP_JMP:   pc += (int)(in>>16) - 1; break;
+      case OP_SPAWN: if(nSpawn < SCRIPT_MAX_SPAWN) spawn[nSpawn++] = (R[a]>=0.f && R[a]<=7.f) ? (int)R[a] : 0; break;
+    }
+  }
+}
+
+// --- Level Packs ---
+// A pack is a text file of brick layouts:
+//   # comment
+//   level <name>
+//   <one line per brick row, top row first>
+// Cells are '.' (empty), '1'..'7' (palette colour, 1 hp), 'A'..'G' (palette
+// colour, 2 hp) or a lowercase brick type declared with `brick` ahead of the
+// first level (see Brick Scripts); blank lines are ignored and short rows are
+// padded with '.'.
+// The built-in layout is the same grid generated by defaultLevel().
+static const float brickPalette[7][3] = {
+  {0.9f, 0.2f, 0.4f}, {0.9f, 0.6f, 0.1f}, {0.9f, 0.9f, 0.2f},
+  {0.2f, 0.8f, 0.4f}, {0.2f, 0.6f, 0.9f}, {0.5f, 0.3f, 0.9f},
+  {0.8f, 0.8f, 0.8f}
+};
+
+static bool loadLevelPack(const std::string& path, std::vector<Level>& out){
+  std::ifstream in(path);
+  if(!in){ std::fprintf(stderr, "pack: cannot read %s\n", path.c_str()); return false; }
+  out.clear(); brickTypes.assign(1, BrickType()); scriptCode.clear(); scriptConsts.clear();
+  std::vector<std::string> rows; std::string line; int ln=0;
+  ScriptCompiler sc; int handler=-1;   // event being compiled, -1 outside handlers
+  auto fail = [&](const char* what){ std::fprintf(stderr, "pack: %s:%d: %s\n", path.c_str(), ln, what); return false; };
+  auto finish = [&]{
+    if(out.empty()) return true;
+    Level& L = out.back();
+    if(rows.empty()) return fail("level has no rows");
+    L.rows = (int)rows.size(); L.cols = 0;
+    for(const std::string& r : rows) L.cols = std::max(L.cols, (int)r.size());
+    if(L.rows > LEVEL_MAX_ROWS || L.cols > LEVEL_MAX_COLS) return fail("level larger than 16 rows x 32 columns");
+    L.cells.assign((size_t)L.rows*L.cols, '.');
+    for(size_t r=0;r<rows.size();r++) std::copy(rows[r].begin(), rows[r].end(), L.cells.begin() + r*L.cols);
+    rows.clear();
+    return true;
+  };
+  while(std::getline(in, line)){
+    ++ln;
+    if(!line.empty() && line.back()=='\r') line.pop_back();
+    size_t lead = line.find_first_not_of(" \t");
+    if(lead==std::string::npos || line[lead]=='#') continue;
+    if(handler>=0){
+      bool done=false;
+      if(!sc.line(line.substr(lead), &done)) return fail(sc.err.c_str());
+      if(done){ brickTypes.back().on[handler]=sc.handler(); handler=-1; }
+      continue;
+    }
+    if(line.compare(lead, 6, "brick ")==0){
+      BrickType bt; char cell=0;
+      if(!out.empty()) return fail("brick types must come before the first level");
+      if(std::sscanf(line.c_str()+lead, "brick %c %d %d", &cell, &bt.colour, &bt.hp)!=3 || cell<'a' || cell>'z' ||
+         bt.colour<1 || bt.colour>7 || bt.hp<1 || bt.hp>99) return fail("expected 'brick <a-z> <colour 1-7> <hp 1-99>'");
+      for(const BrickType& o : brickTypes) if(o.cell==cell) return fail("brick type declared twice");
+      bt.cell=cell; brickTypes.push_back(bt);
+      continue;
+    }
+    static const char* events[EV_COUNT] = {"on_hit", "on_tick", "on_destroy"};
+    int ev=-1; for(int k=0;k<EV_COUNT;k++) if(line.compare(lead, std::string::npos, events[k])==0) ev=k;
+    if(ev>=0){
+      if(brickTypes.size()<2 || !out.empty()) return fail("handler outside a brick type");
+      if(brickTypes.back().on[ev].entry>=0) return fail("handler defined twice");
+      sc.begin(); handler=ev;
+      continue;
+    }
+    if(line.compare(0, 5, "level")==0 && (line.size()==5 || line[5]==' ')){
+      if(!finish()) return false;
+      out.push_back(Level());
+      out.back().name = line.size()>6 ? line.substr(6) : "LEVEL "+std::to_string(out.size());
+      continue;
+    }
+    if(out.empty()) return fail("brick row before the first 'level' line");
+    for(char ch : line){
+      bool typed=false; for(const BrickType& o : brickTypes) typed |= o.cell && o.cell==ch;
+      if(!(ch=='.' || (ch>='1' && ch<='7') || (ch>='A' && ch<='G') || typed)) return fail("cell must be '.', '1'..'7', 'A'..'G' or a declared brick type");
+    }
+    rows.push_back(line);
+  }
+  if(handler>=0) return fail("handler without 'end'");
+  if(!finish()) return false;
+  if(out.empty()){ ln=0; return fail("no levels"); }
+  return true;
+}
+
+// The classic wall: palette colour per row, the top two rows take two hits.
+static Level defaultLevel(int rows,int cols){
+  Level L; L.name="CLASSIC"; L.rows=rows; L.cols=cols;
+  for(int r=0;r<rows;r++) L.cells.append((size_t)cols, (char)((r<2 ? 'A' : '1') + r%7));
+  return L;
+}
+
+// World-space bricks for a layout; touches no game state, so thumbnail jobs
+// can lay out levels on any thread.
+static void layoutLevel(const Level& L, std::vector<Brick>& out){
+  float marginX=70.f, marginY=100.f, gap=6.f;
+  float areaW = scrW - 2*marginX;
+  float bw = (areaW - (L.cols-1)*gap)/L.cols;
+  float bh = 22.f;
+
+  for(int r=0;r<L.rows;r++){
+    for(int c=0;c<L.cols;c++){
+      char ch = L.cells[(size_t)r*L.cols + c]; if(ch=='.') continue;
+      int type=0, k, hp;
+      if(ch>='a' && ch<='z'){
+        while(brickTypes[type].cell!=ch) type++;
+        k = brickTypes[type].colour-1; hp = brickTypes[type].hp;
+      } else { k = ch>='A' ? ch-'A' : ch-'1'; hp = ch>='A' ? 2 : 1; }
+      Brick b;
+      b.x = marginX + c*(bw+gap) + bw/2.f;
+      b.y = scrH - marginY - r*(bh+gap) - bh/2.f;
+      b.w=bw; b.h=bh; b.alive=true; b.hp=hp; b.type=type; std::fill(b.var, b.var+4, 0.f);
+      b.r = brickPalette[k][0]; b.g = brickPalette[k][1]; b.b = brickPalette[k][2];
+      b.score = 50 + 10*r;
+      out.push_back(b);
+    }
+  }
+}
+
+static void buildLevel(const Level& L){
+  bricks.clear(); brickLayerStale=true; dirtyBricks.clear(); forkSynced=false;
+  layoutLevel(L, bricks);
+  bricksAlive = (int)bricks.size();
+  gridBuild();
+  tickBricks.clear();
+  for(size_t i=0;i<bricks.size();++i) if(brickTypes[bricks[i].type].on[EV_TICK].entry>=0) tickBricks.push_back((int)i);
+}
+
+static void buildBricks(int rows=7,int cols=12){ buildLevel(defaultLevel(rows, cols)); }
+
+static void newGameSeeded(uint32_t seed);
+static void newGame(){ newGameSeeded((uint32_t)rng()); }
+
+static void newGameSeeded(uint32_t seed){
+  rng.seed(seed); beginRecording(seed);
+  leftHeld=false; rightHeld=false;  // a replay must not depend on the previous game's input
+  score=0; lives=3; globalSpeedGain=0.f; perks.clear(); bullets.clear(); fxClear();
+  paddle.pos={scrW/2.f, 48.f}; paddle.w=120.f; paddle.h=16.f;
+  paddle.speed=630.f; paddle.shooting=false;
+  ball.radius=9.f; ball.speed=320.f; ball.stuck=true; ball.through=false; ball.fireball=false;
+  resetBallOnPaddle();
+  if(levelIndex>=0 && levelIndex<(int)levelPack.size()) buildLevel(levelPack[levelIndex]); else buildBricks();
+  startTime = nowSec(); playTime=0.f; slowAccum=0.f;
+  current=PLAY; canResume=true;
+}
+
+// Exit to main menu handler: clear play-state and return to menu
+static void exitToMenu(){
+  perks.clear(); bullets.clear(); fxClear();
+  // reset some gameplay state
+  bricks.clear(); bricksAlive=0; brickLayerStale=true; dirtyBricks.clear(); gridCells.clear(); tickBricks.clear(); forkSynced=false;
+  score = 0;
+  lives = 3;
+  globalSpeedGain = 0.f;
+  paddle.pos = {scrW/2.f, 48.f}; paddle.w = 120.f; paddle.h = 16.f;
+  ball.radius = 9.f; ball.speed = 320.f;
+  resetBallOnPaddle();
+  canResume = false;
+  current = MENU;
+  pauseMenuIndex = 0;
+}
+
+static void dropPerk(PerkType t,float x,float y){
+  Perk pk; pk.pos={x,y}; pk.vel={0,-150.f}; pk.size=18.f; pk.alive=true; pk.type=t;
+  perks.push_back(pk);
+}
+
+static void maybeSpawnPerk(const Brick& b){
+  float p=tuning.perkChance; if(u01(rng)<p){
+    float r=u01(rng);
+    dropPerk(perkRoll[perkRollIndex(r)], b.x, b.y);
+  }
+}
+
+// Runs one handler for brick i and applies what it changed. Values that are
+// not finite are dropped and positions stay on the playfield. A move re-files
+// the brick in the broadphase and rebuilds the brick layer; other visible
+// changes patch it through the dirty list.
+static thread_local float scriptDt=0.f;
+static float brickEvent(int i, const ScriptHandler& h, float damage, float* R){
+  Brick& b = bricks[i]; touchBrick(i);
+  std::fill(R+SR_LOCALS, R+SR_LOCALS+h.locals, 0.f);
+  R[SR_HP]=(float)b.hp; R[SR_X]=b.x; R[SR_Y]=b.y; R[SR_R]=b.r; R[SR_G]=b.g; R[SR_B]=b.b;
+  for(int k=0;k<4;k++) R[SR_V0+k]=b.var[k];
+  R[SR_W]=b.w; R[SR_H]=b.h; R[SR_DT]=scriptDt; R[SR_TIME]=playTime;
+  R[SR_BALLX]=ball.pos.x; R[SR_BALLY]=ball.pos.y; R[SR_DAMAGE]=damage;
+  int spawn[SCRIPT_MAX_SPAWN], nSpawn=0;
+  scriptExec(h.entry, R, spawn, nSpawn); ++scriptRuns;
+
+  uint32_t w = h.writes;   // only fields the handler can assign need checking
+  for(int k=0;k<4;k++) if((w>>(SR_V0+k) & 1) && std::isfinite(R[SR_V0+k])) b.var[k]=R[SR_V0+k];
+  bool dirty=false;
+  if((w>>SR_HP & 1) && std::isfinite(R[SR_HP])){ int hp=(int)clampv(R[SR_HP], -1.f, 99.f); dirty |= hp!=b.hp; b.hp=hp; }
+  float* col[3] = {&b.r, &b.g, &b.b};
+  for(int k=0;k<3;k++) if((w>>(SR_R+k) & 1) && std::isfinite(R[SR_R+k])){ float c=clampv(R[SR_R+k], 0.f, 1.f); dirty |= c!=*col[k]; *col[k]=c; }
+  if(w & (1u<<SR_X | 1u<<SR_Y)){
+    float nx = std::isfinite(R[SR_X]) ? clampv(R[SR_X], b.w/2.f, scrW-b.w/2.f) : b.x;
+    float ny = std::isfinite(R[SR_Y]) ? clampv(R[SR_Y], b.h/2.f, scrH-b.h/2.f) : b.y;
+    if(nx!=b.x || ny!=b.y){
+      if(b.alive) gridRemove(i);
+      b.x=nx; b.y=ny;
+      if(b.alive) gridInsert(i);
+      brickLayerStale=true;
+    }
+  }
+  if(dirty) markBrickDirty(i);
+  for(int k=0;k<nSpawn;k++) dropPerk((PerkType)spawn[k], b.x, b.y);
+  return std::isfinite(R[SR_DAMAGE]) ? R[SR_DAMAGE] : damage;
+}
+
+// hp reached zero: on_destroy may revive the brick by giving it hp back.
+static void destroyBrick(int i){
+  Brick& b = bricks[i]; touchBrick(i);
+  const ScriptHandler& h = brickTypes[b.type].on[EV_DESTROY];
+  if(h.entry>=0){ float R[SR_COUNT]; scriptLoadConsts(R); brickEvent(i, h, 0.f, R); if(b.hp>0) return; }
+  b.alive=false; --bricksAlive; gridRemove(i); maybeSpawnPerk(b);
+}
+
+// One hit from the ball or a bullet; on_hit may change the damage.
+static void hitBrick(int i){
+  Brick& b = bricks[i]; touchBrick(i);
+  int damage = 1; const ScriptHandler& h = brickTypes[b.type].on[EV_HIT];
+  if(h.entry>=0){ float R[SR_COUNT]; scriptLoadConsts(R); damage = (int)clampv(brickEvent(i, h, 1.f, R), 0.f, 99.f); }
+  if(damage>0){ b.hp-=damage; score += b.score; markBrickDirty(i); }
+  if(b.hp<=0) destroyBrick(i);
+}
+
+static void scriptTick(float dt){
+  scriptDt = dt;
+  float R[SR_COUNT]; scriptLoadConsts(R);
+  for(size_t k=0;k<tickBricks.size();++k){
+    int i = tickBricks[k]; Brick& b = bricks[i]; if(!b.alive) continue;
+    brickEvent(i, brickTypes[b.type].on[EV_TICK], 0.f, R);
+    if(b.hp<=0) destroyBrick(i);
+  }
+}
+
+static void applyPerk(PerkType t){
+  LOG("perk applied type=%d lives=%d score=%d", (int)t, lives, score);
+  switch(t){
+    case EXTRA_LIFE:      lives = (lives<MAX_LIVES? lives+1:MAX_LIVES); break;
+    case SPEED_UP:        ball.speed *= 1.18f;                     break;
+    case WIDE_PADDLE:     paddle.w = (paddle.w*1.35f<320.f? paddle.w*1.35f:320.f); fxApply(FX_WIDTH, 0, 14.f, FX_REPLACE); break;
+    case SHRINK_PADDLE:   paddle.w = (paddle.w*0.7f>60.f?  paddle.w*0.7f:60.f);  fxApply(FX_WIDTH, 0, 12.f, FX_REPLACE); break;
+    case THROUGH_BALL:    ball.through=true; fxApply(FX_THROUGH, 0, 10.f, FX_REPLACE); break;
+    case FIREBALL:        ball.fireball=true; fxApply(FX_FIREBALL, 0, 8.f, FX_REPLACE);
+                          ball.through=true;  fxApply(FX_THROUGH, 0, 8.f, FX_REFRESH); break;
+    case INSTANT_DEATH:   lives = 0; current=GAMEOVER; saveHighScore(); canResume=false; break;
+    case SHOOTING_PADDLE: paddle.shooting=true; fxApply(FX_SHOOTING, 0, 12.f, FX_REPLACE); break;
+  }
+}
+
+// Effect expiry; target 0 is the ball or the paddle.
+static void fxExpire(int kind, int, int){
+  switch(kind){
+    case FX_THROUGH:  ball.through=false;  break;
+    case FX_FIREBALL: ball.fireball=false; break;
+    case FX_WIDTH:    paddle.w=120.f;      break;
+    case FX_SHOOTING: paddle.shooting=false; break;
+  }
+}
+// Collision detection: Axis-Aligned Bounding Box (AABB) vs Circle
+static bool aabbCircleCollision(float rx,float ry,float rw,float rh, Vec2 c,float r, Vec2* nrm,float* pen){
+  float cx = clampv(c.x, rx-rw/2.f, rx+rw/2.f);
+  float cy = clampv(c.y, ry-rh/2.f, ry+rh/2.f);
+  float dx = c.x - cx, dy = c.y - cy;
+  float d2 = dx*dx + dy*dy; if(d2 > r*r) return false;
+  float d = std::sqrt(d2<1e-6f?1e-6f:d2);
+  if(nrm){ if(d>1e-4f) *nrm = {dx/d, dy/d}; else *nrm = {0.f,1.f}; }
+  if(pen) *pen = r - d;
+  return true;
+}
+static void reflectBall(Vec2 n){
+  Vec2 v=ball.vel; float sp=length(v); if(sp<1e-6f) return;
+  Vec2 dir = v*(1.f/sp);
+  Vec2 r   = dir - n*(2.f*dot(dir,n));
+  ball.vel = normalize(r) * ball.speed;
+}
+
+static void loseLife(){
+  heatDeath(ball.pos.x);
+  LOG("life lost x=%.1f lives=%d t=%.2f", (double)ball.pos.x, lives, (double)playTime);
+  if(lives > 0) lives--;
+  if(lives <= 0){
+    lives = 0;
+    current=GAMEOVER; saveHighScore(); canResume=false;
+  } else {
+    paddle.pos.x = scrW/2.f; paddle.w=120.f; paddle.shooting=false;
+    fxCancel(FX_WIDTH, 0); fxCancel(FX_SHOOTING, 0);
+    resetBallOnPaddle();
+  }
+}
+
+static void launchBall(){
+  ball.stuck=false; ball.vel = normalize(Vec2{0.2f,1.f})*ball.speed; hasLaunched=true;
+}
+
+static void fireBullet(){
+  if(!paddle.shooting) return;
+  Bullet b; b.pos={paddle.pos.x, paddle.pos.y + paddle.h/2.f + 8.f}; b.vel={0,640.f}; b.w=4.f; b.h=10.f; b.alive=true;
+  bullets.push_back(b);
+}
+
+static void applyInput(int kind,float value){
+  switch(kind){
+    case IN_LEFT:  leftHeld  = value!=0.f; break;
+    case IN_RIGHT: rightHeld = value!=0.f; break;
+    case IN_PADDLE_X: {
+      float minX = paddle.w/2.f+6.f, maxX = scrW - paddle.w/2.f - 6.f;
+      paddle.pos.x = clampv(value, minX, maxX);
+    } break;
+    case IN_LAUNCH_KEY:   if(ball.stuck) launchBall(); break;
+    case IN_LAUNCH_MOUSE: if(ball.stuck){ ball.stuck=false; ball.vel = normalize(Vec2{0,1})*ball.speed; } break;
+    case IN_FIRE:         fireBullet(); break;
+  }
+}
+static void playerInput(int kind,float value=0.f){
+  recording.events.push_back({(uint32_t)recording.dts.size(), (uint8_t)kind, value});
+  applyInput(kind, value);
+}
+
+// --- Game Logic Update ---
+static void perkFall(float sdt){
+  Perk* P = perks.data(); bool heat = heatOn && !branchSim;   // this thread's branchSim, not the worker's
+  parallelFor((int)perks.size(), 256, [P,sdt,heat](int b,int e){
+    for(int i=b;i<e;i++){ Perk& p=P[i]; if(!p.alive) continue;
+      p.pos = p.pos + p.vel*sdt; if(p.pos.y < -30.f){ p.alive=false; if(heat) heatGrid()->perkMiss[heatX(p.pos.x)]++; } }
+  });
+}
+
+static void updateGame(float dt){
+  // Update Timers and Speed
+  perfMark(PH_PADDLE);
+  ball.speed += dt*tuning.speedRate;
+  slowAccum += dt;
+  float sdt = 0.f;   // this tick's step for the slow subsystems, 0 if they wait
+  int rate = replayRate ? replayRate : slowRate;
+  if(rate<=1 || slowAccum >= (rate-0.5f)*FX_TICK){ sdt = slowAccum; slowAccum = 0.f; }
+  if(sdt > 0.f){ globalSpeedGain += sdt*tuning.gainRate; fxAdvance(sdt); }
+
+  // Update Paddle Movement
+  float vx=0.f; if(leftHeld) vx -= paddle.speed; if(rightHeld) vx += paddle.speed;
+  paddle.pos.x += vx*dt;
+  paddle.pos.x = clampv(paddle.pos.x, paddle.w/2.f+6.f, scrW - paddle.w/2.f - 6.f);
+
+  // Update Ball Movement
+  perfMark(PH_BALL_WALLS);
+  if(ball.stuck){
+    ball.pos.x = paddle.pos.x;
+    ball.pos.y = paddle.pos.y + paddle.h/2.f + ball.radius + 1.f;
+  } else {
+    ball.pos = ball.pos + ball.vel*dt;
+
+    // Wall reflection
+    if(ball.pos.x - ball.radius < 0){ ball.pos.x = ball.radius; ball.vel.x = std::fabs(ball.vel.x); }
+    if(ball.pos.x + ball.radius > scrW){ ball.pos.x = scrW - ball.radius; ball.vel.x = -std::fabs(ball.vel.x); }
+    if(ball.pos.y + ball.radius > scrH){ ball.pos.y = scrH - ball.radius; ball.vel.y = -std::fabs(ball.vel.y); }
+
+    // Bottom boundary (lose life)
+    // Perks skip this tick, as at rate 1, but not the earlier ticks in sdt.
+    if(ball.pos.y - ball.radius < 0){ if(sdt > dt) perkFall(sdt - dt); loseLife(); return; }
+
+    // Paddle Collision
+    Vec2 n; float pen; ++statPaddleTests;
+    if(aabbCircleCollision(paddle.pos.x,paddle.pos.y,paddle.w,paddle.h, ball.pos, ball.radius, &n,&pen)){
+      ball.pos = ball.pos + n*pen;
+      // Angle reflection based on hit position
+      float rel = (ball.pos.x - paddle.pos.x) / (paddle.w/2.f); rel = clampv(rel,-1.f,1.f);
+      Vec2 dir = normalize(Vec2{rel, 1.2f});
+      ball.vel = dir * ball.speed; ball.vel.y = std::fabs(ball.vel.y);
+    }
+
+    // Brick Collision
+    // Candidates come from the broadphase around the ball; the margin covers
+    // the position corrections applied while walking them. Contacts persist:
+    // a brick touched last tick whose box the ball still overlaps stays in
+    // contact without a narrowphase test, and only entering contacts deal
+    // damage (a through-ball used to score every tick it overlapped). Bricks
+    // that drop out of the cache have exited. A contact reflects only if the
+    // ball is moving into it, so two overlapping bricks cannot cancel out.
+    // Slots are held back for last tick's contacts not yet visited, so a stay
+    // always fits; an entering brick that finds the cache full is bounced off
+    // but not damaged, since it would count as entering again next tick.
+    perfMark(PH_BRICKS);
+    static thread_local std::vector<int> near;
+    float m = 4.f*ball.radius;
+    gridQuery(ball.pos.x-m, ball.pos.y-m, ball.pos.x+m, ball.pos.y+m, near);
+    int prev[BALL_CONTACTS], np = ball.nContacts, held = np;
+    std::copy(ball.contacts, ball.contacts+np, prev); ball.nContacts = 0;
+    for(size_t k=0;k<near.size();++k){
+      size_t i = (size_t)near[k];
+      Brick& b = bricks[i]; if(!b.alive) continue;
+      if(std::find(prev, prev+np, (int)i) != prev+np){
+        --held;
+        if(std::fabs(ball.pos.x - b.x) <= b.w/2.f + ball.radius && std::fabs(ball.pos.y - b.y) <= b.h/2.f + ball.radius){
+          if(ball.nContacts < BALL_CONTACTS) ball.contacts[ball.nContacts++] = (int)i;
+          continue;   // stay
+        }
+      }
+      Vec2 bn; float bpen; ++statBallBrickTests;
+      if(aabbCircleCollision(b.x,b.y,b.w,b.h, ball.pos, ball.radius, &bn,&bpen)){  // enter
+        heatImpact(ball.pos.x, ball.pos.y);
+        bool cached = ball.nContacts + held < BALL_CONTACTS;
+        if(cached) ball.contacts[ball.nContacts++] = (int)i;
+        if(bpen > 0.5f*ball.radius) LOG("deep brick contact brick=%d pen=%.2f speed=%.1f", (int)i, (double)bpen, (double)ball.speed);
+        if(cached) hitBrick((int)i);
+        if(!(ball.through || ball.fireball)){ ball.pos = ball.pos + bn*bpen; if(dot(ball.vel, bn) < 0.f) reflectBall(bn); }
+      }
+    }
+  }
+
+  // Perk Movement and Collection (slow rate)
+  // Falling is independent per perk and runs in parallel; collection applies
+  // perks in index order on this thread, exactly as the serial loop did.
+  perfMark(PH_PERKS);
+  if(sdt > 0.f) perkFall(sdt);
+  for(size_t i=0; sdt > 0.f && i<perks.size(); ++i){
+    Perk& p=perks[i]; if(!p.alive) continue; ++statPerkTests;
+    if(std::fabs(p.pos.x - paddle.pos.x) <= (paddle.w/2.f + p.size/2.f) &&
+       std::fabs(p.pos.y - paddle.pos.y) <= (paddle.h/2.f + p.size/2.f)){
+      p.alive=false; applyPerk(p.type); if(lives<=0){ return; }
+    }
+  }
+
+  // Bullet Movement and Collision
+  // Movement and the first-hit brick search run in parallel against the brick
+  // table as it stands; hits are resolved in bullet order here. A candidate
+  // killed by an earlier bullet is re-searched from the next brick on, so the
+  // outcome matches the serial loop.
+  perfMark(PH_BULLETS);
+  static thread_local std::vector<int> bulletHit; bulletHit.assign(bullets.size(), -1);
+  {
+    Bullet* B = bullets.data(); int* H = bulletHit.data(); float top = scrH+20.f; GridView g = gridView();
+    parallelFor((int)bullets.size(), 256, [B,H,top,dt,g](int b,int e){
+      for(int i=b;i<e;i++){ Bullet& bu=B[i]; if(!bu.alive) continue;
+        bu.pos = bu.pos + bu.vel*dt;
+        if(bu.pos.y > top){ bu.alive=false; continue; }
+        H[i] = gridFirstAt(g, bu.pos.x, bu.pos.y, 0);
+      }
+    });
+  }
+  for(size_t i=0;i<bullets.size();++i){
+    Bullet& bu = bullets[i]; if(!bu.alive) continue; ++statBulletTests;
+    if(bulletHit[i]<0) continue;
+    int j = bricks[bulletHit[i]].alive ? bulletHit[i] : gridFirstAt(bu.pos.x, bu.pos.y, bulletHit[i]+1);
+    if(j<0) continue;
+    bu.alive=false; hitBrick(j);
+  }
+
+  // Scripted bricks (on_tick)
+  perfMark(PH_SCRIPTS);
+  if(!tickBricks.empty()) scriptTick(dt);
+
+  // Check for Win Condition
+  perfMark(PH_WIN);
+  if(bricksAlive<=0){ current=WIN; saveHighScore(); canResume=false; }
+}
+// --- GL Backend ---
+
+static void glRectFilled(float cx,float cy,float w,float h){
+  float x0=cx-w/2.f, x1=cx+w/2.f, y0=cy-h/2.f, y1=cy+h/2.f;
+  glBegin(GL_QUADS);
+  glVertex2f(x0,y0); glVertex2f(x1,y0); glVertex2f(x1,y1); glVertex2f(x0,y1);
+  glEnd();
+}
+
+static void glRectOutline(float cx,float cy,float w,float h){
+  float x0=cx-w/2.f, x1=cx+w/2.f, y0=cy-h/2.f, y1=cy+h/2.f;
+  glBegin(GL_LINE_LOOP);
+    glVertex2f(x0,y0); glVertex2f(x1,y0); glVertex2f(x1,y1); glVertex2f(x0,y1);
+  glEnd();
+}
+
+static void glCircleFilled(float cx,float cy,float r,int seg){
+  glBegin(GL_TRIANGLE_FAN);
+  glVertex2f(cx,cy);
+  for(int i=0;i<=seg;i++){ float th=(float)i*(float)(2.0*M_PI)/seg;
+    glVertex2f(cx+cosf(th)*r, cy+sinf(th)*r); }
+  glEnd();
+}
+
+static void glText(float x,float y,const std::string& s, void* font){
+  glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
+  glRasterPos2f(x,y); for(size_t i=0;i<s.size();++i) glutBitmapCharacter(font, s[i]);
+  glPopMatrix();
+}
+
+// Perk icon line segments in unit space, shared by every backend.
+struct PerkIcon { float r,g,b; int n; float v[16]; };  // n segments, (x0,y0,x1,y1) each
+static const PerkIcon perkIcons[] = {
+  /* EXTRA_LIFE */      {1.0f,0.2f,0.2f, 3, {-0.5f,0.2f, 0.0f,0.8f,  0.5f,0.2f, 0.0f,0.8f,  -0.5f,0.2f, 0.5f,0.2f}},
+  /* SPEED_UP */        {0.9f,0.9f,0.2f, 3, {-0.5f,-0.5f, 0.0f,0.5f,  0.5f,-0.5f, 0.0f,0.5f,  -0.3f,0.0f, 0.3f,0.0f}},
+  /* WIDE_PADDLE */     {0.3f,1.0f,0.3f, 1, {-0.9f,0.0f, 0.9f,0.0f}},
+  /* SHRINK_PADDLE */   {1.0f,0.5f,0.1f, 1, {-0.4f,0.0f, 0.4f,0.0f}},
+  /* THROUGH_BALL */    {0.2f,0.8f,1.0f, 4, {0.0f,0.8f, -0.8f,0.0f,  -0.8f,0.0f, 0.0f,-0.8f,  0.0f,-0.8f, 0.8f,0.0f,  0.8f,0.0f, 0.0f,0.8f}},
+  /* FIREBALL */        {1.0f,0.4f,0.0f, 2, {-0.5f,-0.5f, 0.5f,0.5f,  0.5f,-0.5f, -0.5f,0.5f}},
+  /* INSTANT_DEATH */   {0.8f,0.0f,0.8f, 2, {-0.6f,0.6f, 0.6f,-0.6f,  0.6f,0.6f, -0.6f,-0.6f}},
+  /* SHOOTING_PADDLE */ {0.9f,0.9f,0.2f, 2, {0.0f,-0.5f, 0.0f,0.5f,  -0.3f,0.5f, 0.3f,0.5f}},
+};
+
+static void glPerkIcon(PerkType t,float x,float y,float s){
+  const PerkIcon& ic = perkIcons[t];
+  glPushMatrix(); glTranslatef(x,y,0); glScalef(s,s,1);
+  glColor3f(ic.r, ic.g, ic.b);
+  glBegin(GL_LINES);
+  for(int i=0;i<ic.n*4;i+=2) glVertex2f(ic.v[i], ic.v[i+1]);
+  glEnd();
+  glPopMatrix();
+}
+
+static void brickColor(const Brick& b,float* rgb){
+  float multiplier = (b.hp == 2) ? 1.0f : 0.6f;
+  rgb[0]=b.r*multiplier; rgb[1]=b.g*multiplier; rgb[2]=b.b*multiplier;
+}
+
+// Brick layer cache (GL): bricks are drawn once into the back buffer and
+// copied into a texture; afterwards only dirty brick rectangles are redrawn
+// and copied in, and each frame composites the texture with one quad.
+static GLuint brickTex=0; static int brickTexW=0, brickTexH=0, brickTexForW=0, brickTexForH=0;
+
+static void glBrick(const Brick& b){
+  float rgb[3]; brickColor(b, rgb);
+  glColor3f(rgb[0],rgb[1],rgb[2]); glRectFilled(b.x, b.y, b.w, b.h);
+  glColor3f(0.1f, 0.1f, 0.1f);     glRectOutline(b.x, b.y, b.w, b.h);
+}
+
+static void glUpdateBrickLayer(){
+  if(brickTex==0) glGenTextures(1, &brickTex);
+  glBindTexture(GL_TEXTURE_2D, brickTex);
+  if(brickTexW < winW || brickTexH < winH){
+    brickTexW=1; while(brickTexW<winW) brickTexW<<=1;   // GL 1.1: power-of-two textures
+    brickTexH=1; while(brickTexH<winH) brickTexH<<=1;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, brickTexW, brickTexH, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    brickLayerStale = true;
+  }
+  if(brickTexForW!=winW || brickTexForH!=winH) brickLayerStale = true;
+  if(brickLayerStale){
+    glClearColor(clearR,clearG,clearB,1.0f); glClear(GL_COLOR_BUFFER_BIT);
+    for(size_t i=0;i<bricks.size();++i) if(bricks[i].alive) glBrick(bricks[i]);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0,0, 0,0, winW, winH);
+    brickTexForW=winW; brickTexForH=winH;
+  } else {
+    for(size_t k=0;k<dirtyBricks.size();++k){
+      const Brick& b = bricks[dirtyBricks[k]];
+      float sx = (float)winW/scrW, sy = (float)winH/scrH;   // playfield units to window pixels
+      int x0 = std::max(0, (int)std::floor((b.x-b.w/2.f)*sx)-1), x1 = std::min(winW, (int)std::ceil((b.x+b.w/2.f)*sx)+1);
+      int y0 = std::max(0, (int)std::floor((b.y-b.h/2.f)*sy)-1), y1 = std::min(winH, (int)std::ceil((b.y+b.h/2.f)*sy)+1);
+      if(x1<=x0 || y1<=y0) continue;
+      glColor3f(clearR,clearG,clearB);
+      glRectFilled((x0+x1)/2.f/sx, (y0+y1)/2.f/sy, (x1-x0)/sx, (y1-y0)/sy);
+      if(b.alive) glBrick(b);
+      glCopyTexSubImage2D(GL_TEXTURE_2D, 0, x0,y0, x0,y0, x1-x0, y1-y0);
+    }
+  }
+  brickLayerStale = false; dirtyBricks.clear();
+}
+
+static void glBrickLayer(){
+  float u = (float)winW/brickTexW, v = (float)winH/brickTexH;
+  glBindTexture(GL_TEXTURE_2D, brickTex);
+  glEnable(GL_TEXTURE_2D); glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glBegin(GL_QUADS);
+  glTexCoord2f(0,0); glVertex2f(0,0);                glTexCoord2f(u,0); glVertex2f((float)scrW,0);
+  glTexCoord2f(u,v); glVertex2f((float)scrW,(float)scrH); glTexCoord2f(0,v); glVertex2f(0,(float)scrH);
+  glEnd();
+  glDisable(GL_TEXTURE_2D);
+}
+
+static GLuint thumbTex=0; static int thumbTexW=0, thumbTexH=0;
+
+static void glThumb(int i,float cx,float cy,float w,float h){
+  const ThumbAtlas& A = thumbAtlas;
+  if(i<0 || i>=(int)A.x.size()) return;
+  if(thumbTex==0){
+    thumbTexW=1; while(thumbTexW<A.w) thumbTexW<<=1;
+    thumbTexH=1; while(thumbTexH<A.h) thumbTexH<<=1;
+    glGenTextures(1, &thumbTex); glBindTexture(GL_TEXTURE_2D, thumbTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, thumbTexW, thumbTexH, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0,0, A.w,A.h, GL_RGB, GL_UNSIGNED_BYTE, A.rgb.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+  // Atlas row 0 is the top of the image, so v grows downwards.
+  float u0 = (float)A.x[i]/thumbTexW, u1 = (float)(A.x[i]+A.tw)/thumbTexW;
+  float v0 = (float)A.y[i]/thumbTexH, v1 = (float)(A.y[i]+A.th)/thumbTexH;
+  float x0 = cx-w/2.f, x1 = cx+w/2.f, y0 = cy-h/2.f, y1 = cy+h/2.f;
+  glBindTexture(GL_TEXTURE_2D, thumbTex);
+  glEnable(GL_TEXTURE_2D); glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glBegin(GL_QUADS);
+  glTexCoord2f(u0,v1); glVertex2f(x0,y0); glTexCoord2f(u1,v1); glVertex2f(x1,y0);
+  glTexCoord2f(u1,v0); glVertex2f(x1,y1); glTexCoord2f(u0,v0); glVertex2f(x0,y1);
+  glEnd();
+  glDisable(GL_TEXTURE_2D);
+}
+
+static void glQuadBatch(){
+  if(quadBatch.empty()) return;
+  glEnableClientState(GL_VERTEX_ARRAY); glEnableClientState(GL_COLOR_ARRAY);
+  glVertexPointer(2, GL_FLOAT, sizeof(QuadVertex), &quadBatch[0].x);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(QuadVertex), &quadBatch[0].rgba);
+  glDrawArrays(GL_QUADS, 0, (GLsizei)quadBatch.size());
+  glDisableClientState(GL_COLOR_ARRAY); glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+static void submitGL(){
+  if(brickCache) glUpdateBrickLayer();
+  glClearColor(clearR,clearG,clearB,1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  for(size_t i=0;i<frameList.cmds.size();++i){
+    const DrawCmd& c = frameList.cmds[i];
+    glColor3f(c.r, c.g, c.b);
+    switch(c.op){
+      case DRAW_RECT:      glRectFilled(c.x,c.y,c.w,c.h); break;
+      case DRAW_OUTLINE:   glRectOutline(c.x,c.y,c.w,c.h); break;
+      case DRAW_CIRCLE:    glCircleFilled(c.x,c.y,c.w,c.arg); break;
+      case DRAW_TEXT:      glText(c.x,c.y,frameList.strings[c.arg],c.font); break;
+      case DRAW_PERK_ICON: glPerkIcon((PerkType)c.arg,c.x,c.y,c.w); break;
+      case DRAW_BRICK_LAYER: glBrickLayer(); break;
+      case DRAW_THUMB:     glThumb(c.arg,c.x,c.y,c.w,c.h); break;
+      case DRAW_QUADS:     glQuadBatch(); break;
+    }
+  }
+}
+
+// --- Software Backend ---
+// Rasterizes the command list into a 0xAABBGGRR pixel buffer, row 0 at the
+// bottom like the GL projection. Text is not rasterized. A Canvas may scale
+// world coordinates down (thumbnails, low-resolution targets).
+struct Canvas { uint32_t* px; int w,h; float scale; };
+
+static std::vector<uint32_t> softPixels, softBrickLayer;
+static int softLayerW=0, softLayerH=0;
+
+static inline uint32_t packRGB(float r,float g,float b){
+  return 0xFF000000u | ((uint32_t)(clampv(b,0.f,1.f)*255.f+0.5f)<<16)
+                     | ((uint32_t)(clampv(g,0.f,1.f)*255.f+0.5f)<<8) | (uint32_t)(clampv(r,0.f,1.f)*255.f+0.5f);
+}
+
+// Fills pixels whose centres fall inside [x0,x1) x [y0,y1), in canvas pixels.
+static void softSpan(const Canvas& cv,float x0,float y0,float x1,float y1,uint32_t c){
+  int ix0 = std::max(0, (int)std::ceil(x0-0.5f)), ix1 = std::min(cv.w, (int)std::ceil(x1-0.5f));
+  int iy0 = std::max(0, (int)std::ceil(y0-0.5f)), iy1 = std::min(cv.h, (int)std::ceil(y1-0.5f));
+  for(int y=iy0;y<iy1;y++){ uint32_t* row = cv.px + (size_t)y*cv.w; for(int x=ix0;x<ix1;x++) row[x]=c; }
+}
+
+static void softRect(const Canvas& cv,float cx,float cy,float w,float h,uint32_t c){
+  float s=cv.scale; softSpan(cv, (cx-w/2.f)*s, (cy-h/2.f)*s, (cx+w/2.f)*s, (cy+h/2.f)*s, c);
+}
+
+static void softOutline(const Canvas& cv,float cx,float cy,float w,float h,uint32_t c){
+  float s=cv.scale, x0=(cx-w/2.f)*s, x1=(cx+w/2.f)*s, y0=(cy-h/2.f)*s, y1=(cy+h/2.f)*s;
+  softSpan(cv, x0,y0, x1,y0+1.f, c); softSpan(cv, x0,y1-1.f, x1,y1, c);
+  softSpan(cv, x0,y0, x0+1.f,y1, c); softSpan(cv, x1-1.f,y0, x1,y1, c);
+}
+
+static void softCircle(const Canvas& cv,float cx,float cy,float r,uint32_t c){
+  float s=cv.scale; cx*=s; cy*=s; r*=s;
+  int iy0 = std::max(0, (int)std::ceil(cy-r-0.5f)), iy1 = std::min(cv.h, (int)std::ceil(cy+r-0.5f));
+  for(int y=iy0;y<iy1;y++){
+    float dy = (y+0.5f)-cy, hw = std::sqrt(std::max(0.f, r*r-dy*dy));
+    softSpan(cv, cx-hw, (float)y, cx+hw, (float)y+1.f, c);
+  }
+}
+
+static void softLine(const Canvas& cv,float x0,float y0,float x1,float y1,uint32_t c){
+  int n = (int)std::ceil(std::max(std::fabs(x1-x0), std::fabs(y1-y0))); if(n<1) n=1;
+  for(int i=0;i<=n;i++){
+    int x = (int)std::floor(x0 + (x1-x0)*i/n), y = (int)std::floor(y0 + (y1-y0)*i/n);
+    if(x>=0 && x<cv.w && y>=0 && y<cv.h) cv.px[(size_t)y*cv.w + x] = c;
+  }
+}
+
+static void softPerkIcon(const Canvas& cv,int type,float x,float y,float sz){
+  const PerkIcon& ic = perkIcons[type]; uint32_t c = packRGB(ic.r,ic.g,ic.b); float s=cv.scale;
+  for(int i=0;i<ic.n*4;i+=4)
+    softLine(cv, (x+ic.v[i]*sz)*s, (y+ic.v[i+1]*sz)*s, (x+ic.v[i+2]*sz)*s, (y+ic.v[i+3]*sz)*s, c);
+}
+
+static void softBrick(const Canvas& cv,const Brick& b){
+  float rgb[3]; brickColor(b, rgb);
+  softRect(cv, b.x,b.y,b.w,b.h, packRGB(rgb[0],rgb[1],rgb[2]));
+  softOutline(cv, b.x,b.y,b.w,b.h, packRGB(0.1f,0.1f,0.1f));
+}
+
+// Nearest-neighbour blit of one atlas tile into the box centred on (cx,cy).
+static void softThumb(const Canvas& cv,int i,float cx,float cy,float w,float h){
+  const ThumbAtlas& A = thumbAtlas;
+  if(i<0 || i>=(int)A.x.size()) return;
+  float s=cv.scale, x0=(cx-w/2.f)*s, y1=(cy+h/2.f)*s, sw=w*s, sh=h*s;
+  int ix0 = std::max(0, (int)std::ceil(x0-0.5f)), ix1 = std::min(cv.w, (int)std::ceil(x0+sw-0.5f));
+  int iy0 = std::max(0, (int)std::ceil(y1-sh-0.5f)), iy1 = std::min(cv.h, (int)std::ceil(y1-0.5f));
+  for(int y=iy0;y<iy1;y++){
+    int ty = clampv((int)((y1-(y+0.5f))/sh*A.th), 0, A.th-1);   // canvas rows go up, atlas rows go down
+    const uint8_t* src = A.rgb.data() + ((size_t)(A.y[i]+ty)*A.w + A.x[i])*3;
+    uint32_t* row = cv.px + (size_t)y*cv.w;
+    for(int x=ix0;x<ix1;x++){
+      const uint8_t* p = src + 3*clampv((int)((x+0.5f-x0)/sw*A.tw), 0, A.tw-1);
+      row[x] = 0xFF000000u | ((uint32_t)p[2]<<16) | ((uint32_t)p[1]<<8) | p[0];
+    }
+  }
+}
+
+// Retained brick layer: rebuilt when stale, otherwise patched per dirty brick.
+static void softUpdateBrickLayer(){
+  uint32_t bg = packRGB(clearR,clearG,clearB);
+  if(softLayerW!=scrW || softLayerH!=scrH){ softBrickLayer.assign((size_t)scrW*scrH, bg); softLayerW=scrW; softLayerH=scrH; brickLayerStale=true; }
+  Canvas cv = {softBrickLayer.data(), scrW, scrH, 1.f};
+  if(brickLayerStale){
+    std::fill(softBrickLayer.begin(), softBrickLayer.end(), bg);
+    for(size_t i=0;i<bricks.size();++i) if(bricks[i].alive) softBrick(cv, bricks[i]);
+  } else {
+    for(size_t k=0;k<dirtyBricks.size();++k){
+      const Brick& b = bricks[dirtyBricks[k]];
+      softRect(cv, b.x,b.y, b.w+2.f,b.h+2.f, bg);
+      if(b.alive) softBrick(cv, b);
+    }
+  }
+  brickLayerStale = false; dirtyBricks.clear();
+}
+
+static void rasterizeCommands(const Canvas& cv){
+  for(size_t i=0;i<frameList.cmds.size();++i){
+    const DrawCmd& c = frameList.cmds[i]; uint32_t col = packRGB(c.r,c.g,c.b);
+    switch(c.op){
+      case DRAW_RECT:      softRect(cv, c.x,c.y,c.w,c.h, col); break;
+      case DRAW_OUTLINE:   softOutline(cv, c.x,c.y,c.w,c.h, col); break;
+      case DRAW_CIRCLE:    softCircle(cv, c.x,c.y,c.w, col); break;
+      case DRAW_TEXT:      break;
+      case DRAW_PERK_ICON: softPerkIcon(cv, c.arg, c.x,c.y,c.w); break;
+      case DRAW_THUMB:     softThumb(cv, c.arg, c.x,c.y,c.w,c.h); break;
+      case DRAW_QUADS:
+        for(size_t k=0;k+3<quadBatch.size();k+=4){
+          const QuadVertex &a = quadBatch[k], &b = quadBatch[k+2]; float s=cv.scale;
+          softSpan(cv, a.x*s, a.y*s, b.x*s, b.y*s, a.rgba);
+        }
+        break;
+      case DRAW_BRICK_LAYER:
+        if(cv.w==softLayerW && cv.h==softLayerH && cv.scale==1.f) std::memcpy(cv.px, softBrickLayer.data(), softBrickLayer.size()*sizeof(uint32_t));
+        else for(size_t k=0;k<bricks.size();++k) if(bricks[k].alive) softBrick(cv, bricks[k]);
+        break;
+    }
+  }
+}
+
+static void submitSoft(){
+  if(brickCache) softUpdateBrickLayer();
+  // The brick layer already holds the background, so a frame that starts with
+  // it is a straight copy instead of a clear followed by a copy.
+  bool layerFirst = brickCache && !frameList.cmds.empty() && frameList.cmds[0].op==DRAW_BRICK_LAYER;
+  softPixels.resize((size_t)scrW*scrH);
+  if(!layerFirst) std::fill(softPixels.begin(), softPixels.end(), packRGB(clearR,clearG,clearB));
+  Canvas cv = {softPixels.data(), scrW, scrH, 1.f};
+  rasterizeCommands(cv);
+}
+
+// --- Terminal Backend ---
+// --term draws on an ANSI terminal. The frame is rasterized by the software
+// backend at two pixels per character cell, fitted and centred; each cell is
+// an upper half block (U+2580) with the top pixel as 24-bit foreground and
+// the bottom pixel as background, and text commands become plain characters.
+// Only cells that differ from what the terminal already shows are sent: the
+// cursor is moved only when the next changed cell is not where the last write
+// left it (relative moves within a row), and colours only when they change.
+struct TermCell {
+  uint32_t fg, bg; char ch;   // ch 0: half block, otherwise a text character
+  bool operator==(const TermCell& o) const { return ch==o.ch && bg==o.bg && (fg==o.fg || (ch==0 && fg==bg && o.fg==o.bg)); }
+};
+static int termCols=0, termRows=0;
+static std::vector<TermCell> termCells, termShown;
+static std::vector<uint32_t> termPixels;
+static std::string termOut;
+static long long termFrames=0, termBytes=0, termCellsSent=0;
+static int termOx=0, termOy=0; static float termScale=1.f;   // playfield placement, for mouse input
+
+static void termWrite(const std::string& s){
+#ifdef __linux__
+  size_t off=0;
+  while(off < s.size()){
+    ssize_t n = write(1, s.data()+off, s.size()-off);
+    if(n < 0){ if(errno==EINTR) continue; break; }
+    off += (size_t)n;
+  }
+#else
+  std::fwrite(s.data(), 1, s.size(), stdout); std::fflush(stdout);
+#endif
+}
+
+static void termColor(char* buf,size_t n,int layer,uint32_t c){
+  std::snprintf(buf, n, "%d;2;%u;%u;%u", layer, c&255u, (c>>8)&255u, (c>>16)&255u);
+}
+
+static void submitTerm(){
+  int cols=200, rows=60;
+#ifdef __linux__
+  winsize ws;
+  if(ioctl(1, TIOCGWINSZ, &ws)==0 && ws.ws_col>0 && ws.ws_row>0){ cols=ws.ws_col; rows=ws.ws_row; }
+#endif
+  if(cols!=termCols || rows!=termRows){
+    termCols=cols; termRows=rows;
+    termCells.assign((size_t)cols*rows, TermCell{0,0,0});
+    termShown.assign((size_t)cols*rows, TermCell{1,2,0});   // matches nothing: first frame is sent in full
+    termOut += "\x1b[0m\x1b[2J";
+  }
+  float s = std::min((float)cols/scrW, 2.f*rows/scrH);
+  int pw = std::max(1, (int)(scrW*s)), ph = std::max(2, (int)(scrH*s)) & ~1;
+  termScale=s; termOx=(cols-pw)/2; termOy=(rows-ph/2)/2;
+  uint32_t bg = packRGB(clearR,clearG,clearB);
+  termPixels.assign((size_t)pw*ph, bg);
+  Canvas cv = {termPixels.data(), pw, ph, s};
+  rasterizeCommands(cv);
+
+  std::fill(termCells.begin(), termCells.end(), TermCell{0,0,0});
+  for(int r=0;r<ph/2;r++){
+    const uint32_t* top = termPixels.data() + (size_t)(ph-1-2*r)*pw;   // canvas rows go up
+    const uint32_t* bot = top - pw;
+    TermCell* row = termCells.data() + (size_t)(termOy+r)*cols + termOx;
+    for(int x=0;x<pw;x++) row[x] = TermCell{top[x], bot[x], 0};
+  }
+  for(size_t i=0;i<frameList.cmds.size();++i){
+    const DrawCmd& c = frameList.cmds[i]; if(c.op!=DRAW_TEXT) continue;
+    const std::string& str = frameList.strings[c.arg];
+    int r = termOy + (int)((ph - (c.y+7.f)*s)/2.f), x = termOx + (int)(c.x*s);   // row through the glyphs, not the baseline
+    if(r<0 || r>=rows) continue;
+    uint32_t fg = packRGB(c.r,c.g,c.b);
+    for(size_t k=0;k<str.size() && x<cols;k++,x++){
+      if(x<0) continue;
+      TermCell& t = termCells[(size_t)r*cols + x];
+      t.fg = fg; t.ch = str[k];
+    }
+  }
+
+  uint32_t curFg=~0u, curBg=~0u; int curR=-1, curC=-1; char a[40], b[40], esc[96];
+  for(int r=0;r<rows;r++){
+    for(int c=0;c<cols;c++){
+      size_t i = (size_t)r*cols + c;
+      const TermCell& t = termCells[i];
+      if(t==termShown[i]) continue;
+      if(r!=curR || c<curC){ std::snprintf(esc, sizeof(esc), "\x1b[%d;%dH", r+1, c+1); termOut += esc; }
+      else if(c>curC){ std::snprintf(esc, sizeof(esc), c-curC==1 ? "\x1b[C" : "\x1b[%dC", c-curC); termOut += esc; }
+      bool solid = t.ch==0 && t.fg==t.bg;              // a blank cell needs only the background
+      bool setFg = !solid && t.fg!=curFg, setBg = t.bg!=curBg;
+      if(setFg || setBg){
+        termColor(a, sizeof(a), 38, t.fg); termColor(b, sizeof(b), 48, t.bg);
+        std::snprintf(esc, sizeof(esc), "\x1b[%s%s%sm", setFg ? a : "", setFg && setBg ? ";" : "", setBg ? b : "");
+        termOut += esc;
+        if(setFg) curFg=t.fg;
+        if(setBg) curBg=t.bg;
+      }
+      if(t.ch) termOut += t.ch; else if(solid) termOut += ' '; else termOut += "\xe2\x96\x80";
+      termShown[i] = t; ++termCellsSent;
+      curR=r; curC=c+1;
+      if(curC>=cols) curR=-1;   // pending wrap: position it explicitly next time
+    }
+  }
+  ++termFrames; termBytes += (long long)termOut.size();
+  if(!termOut.empty()) termWrite(termOut);
+  termOut.clear();
+}
+
+static void presentFrame(){
+  perfMark(PH_R_SUBMIT);
+  ++framesPresented; cmdsPresented += (long long)frameList.cmds.size();
+  switch(backend){
+    case BACKEND_GL:   submitGL(); perfMark(PH_NONE); glutSwapBuffers(); break;
+    case BACKEND_SOFT: submitSoft(); perfMark(PH_NONE); break;
+    case BACKEND_NULL: brickLayerStale = false; dirtyBricks.clear(); perfMark(PH_NONE); break;
+    case BACKEND_TERM: submitTerm(); brickLayerStale = false; dirtyBricks.clear(); perfMark(PH_NONE); break;
+  }
+}
+
+// --- Level Thumbnails ---
+// --thumbs PACK OUT lays out every level of a pack and rasterizes its bricks
+// with the software backend at THUMB_W pixels wide, one parallelFor chunk of
+// levels per job, into a single atlas: OUT.ppm (binary PPM) and OUT.idx
+// ("thumbs N atlasW atlasH tileW tileH", then "x y name" per level).
+static const int THUMB_W = 128;
+
+static int runThumbs(const std::string& packPath, const std::string& out){
+  headless = true;
+  std::vector<Level> pack; if(!loadLevelPack(packPath, pack)) return 1;
+  double t0 = nowSec();
+  int n = (int)pack.size(), per = (int)std::ceil(std::sqrt((double)n));
+  ThumbAtlas A; A.tw = THUMB_W; A.th = (int)std::lround((double)scrH*THUMB_W/scrW);
+  A.w = per*A.tw; A.h = ((n+per-1)/per)*A.th;
+  A.rgb.assign((size_t)A.w*A.h*3, 0); A.x.resize(n); A.y.resize(n);
+  float scale = (float)A.tw/scrW;
+  uint32_t bg = packRGB(0.05f,0.05f,0.08f);   // renderScene()'s clear colour
+  parallelFor(n, 8, [&](int b,int e){
+    std::vector<Brick> K; std::vector<uint32_t> px((size_t)A.tw*A.th);
+    Canvas cv = {px.data(), A.tw, A.th, scale};
+    for(int i=b;i<e;i++){
+      K.clear(); layoutLevel(pack[i], K);
+      std::fill(px.begin(), px.end(), bg);
+      for(const Brick& k : K) softBrick(cv, k);
+      A.x[i] = (i%per)*A.tw; A.y[i] = (i/per)*A.th;
+      for(int y=0;y<A.th;y++){
+        const uint32_t* src = px.data() + (size_t)(A.th-1-y)*A.tw;   // canvas is bottom-up
+        uint8_t* dst = A.rgb.data() + ((size_t)(A.y[i]+y)*A.w + A.x[i])*3;
+        for(int x=0;x<A.tw;x++){ uint32_t c=src[x]; dst[3*x]=(uint8_t)c; dst[3*x+1]=(uint8_t)(c>>8); dst[3*x+2]=(uint8_t)(c>>16); }
+      }
+    }
+  });
+  double t1 = nowSec();
+
+  FILE* f = std::fopen((out+".ppm").c_str(), "wb");
+  bool ok = f && std::fprintf(f, "P6\n%d %d\n255\n", A.w, A.h) > 0 && std::fwrite(A.rgb.data(), 1, A.rgb.size(), f)==A.rgb.size();
+  if(f) ok = std::fclose(f)==0 && ok;
+  FILE* ix = ok ? std::fopen((out+".idx").c_str(), "w") : nullptr;
+  if(ix){
+    std::fprintf(ix, "thumbs %d %d %d %d %d\n", n, A.w, A.h, A.tw, A.th);
+    for(int i=0;i<n;i++) std::fprintf(ix, "%d %d %s\n", A.x[i], A.y[i], pack[i].name.c_str());
+    ok = std::fclose(ix)==0;
+  } else ok = false;
+  if(!ok){ std::fprintf(stderr, "thumbs: cannot write %s.ppm/.idx\n", out.c_str()); return 1; }
+  std::printf("thumbs: %d levels -> %s.ppm (%dx%d, tiles %dx%d)  raster=%.3fs write=%.3fs jobs=%d\n",
+              n, out.c_str(), A.w, A.h, A.tw, A.th, t1-t0, nowSec()-t1, jobWorkers);
+  return 0;
+}
+
+static bool loadThumbAtlas(const std::string& prefix, ThumbAtlas& A){
+  std::ifstream ix(prefix+".idx"); std::string tag; int n=0;
+  if(!(ix >> tag >> n >> A.w >> A.h >> A.tw >> A.th) || tag!="thumbs" || n<0) return false;
+  A.x.resize(n); A.y.resize(n);
+  for(int i=0;i<n;i++){ std::string name; if(!(ix >> A.x[i] >> A.y[i]) || !std::getline(ix, name)) return false; }
+  FILE* f = std::fopen((prefix+".ppm").c_str(), "rb"); if(!f) return false;
+  int w=0, h=0, maxv=0;
+  bool ok = std::fscanf(f, "P6 %d %d %d", &w, &h, &maxv)==3 && std::fgetc(f)!=EOF && w==A.w && h==A.h && maxv==255;
+  if(ok){ A.rgb.resize((size_t)w*h*3); ok = std::fread(A.rgb.data(), 1, A.rgb.size(), f)==A.rgb.size(); }
+  std::fclose(f);
+  return ok;
+}
+
+// --- Rendering Functions for Modern Filled UI ---
+
+// Per-kind command generation; each emitter fills its own DrawList so the
+// kinds can run as jobs on any thread.
+static void emitBricks(DrawList& L,const Brick* K,size_t n){
+  L.cmds.clear(); L.strings.clear(); drawTarget = &L;
+  for(size_t i=0;i<n;++i){
+    const Brick& b=K[i]; if(!b.alive) continue;
+    float rgb[3]; brickColor(b, rgb);
+    setColor(rgb[0], rgb[1], rgb[2]);
+    drawRectFilled(b.x, b.y, b.w, b.h);
+
+    setColor(0.1f, 0.1f, 0.1f);
+    drawRectOutline(b.x, b.y, b.w, b.h);
+  }
+  drawTarget = &frameList;
+}
+
+// lead: time the perks have fallen since their last slow-rate step.
+static void emitPerks(DrawList& L,const Perk* P,size_t n,float lead){
+  L.cmds.clear(); L.strings.clear(); drawTarget = &L;
+  for(size_t i=0;i<n;++i){
+    const Perk& p=P[i]; if(!p.alive) continue;
+    float x = p.pos.x + p.vel.x*lead, y = p.pos.y + p.vel.y*lead;
+    setColor(0.8f, 0.8f, 0.8f);
+    drawRectFilled(x, y, p.size, p.size);
+    drawPerkIcon(p.type, x, y, 8.f);
+  }
+  drawTarget = &frameList;
+}
+
+static void emitBullets(DrawList& L,const Bullet* B,size_t n){
+  L.cmds.clear(); L.strings.clear(); drawTarget = &L;
+  for(size_t i=0;i<n;++i){
+    const Bullet& bu = B[i]; if(!bu.alive) continue;
+    setColor(1.0f, 0.9f, 0.2f);
+    drawRectFilled(bu.pos.x, bu.pos.y, bu.w, bu.h);
+  }
+  drawTarget = &frameList;
+}
+
+static void renderHUD(){
+  setColor(0.9f, 0.9f, 0.9f);
+  drawText(10, scrH-24, std::string("SCORE: ")+std::to_string(score));
+  drawText(10, scrH-48, std::string("LIVES: ")+std::to_string(lives));
+
+  char buf[64]; std::snprintf(buf,sizeof(buf),"TIME: %.1fs", playTime);
+  drawText(scrW-160, scrH-24, buf);
+
+  int y = scrH-72; char pbuf[64];
+  setColor(1.0f, 0.9f, 0.2f);
+  if(ball.through){ std::snprintf(pbuf,sizeof(pbuf),"THROUGH: %ds", (int)std::ceil(fxRemaining(FX_THROUGH,0))); drawText(scrW-200,y,pbuf); y-=22; }
+  if(ball.fireball){ std::snprintf(pbuf,sizeof(pbuf),"FIREBALL: %ds", (int)std::ceil(fxRemaining(FX_FIREBALL,0))); drawText(scrW-200,y,pbuf); y-=22; }
+  if(paddle.shooting){ std::snprintf(pbuf,sizeof(pbuf),"SHOOTING: %ds", (int)std::ceil(fxRemaining(FX_SHOOTING,0))); drawText(scrW-200,y,pbuf); y-=22; }
+}
+
+static void renderProfiler(){
+  setColor(0.6f, 1.0f, 0.8f);
+  if(!perfEnabled){ drawText(10, 70, "PROFILER OFF (RUN WITH --perf)", GLUT_BITMAP_8_BY_13); return; }
+  char row[160]; int y = 20 + 15*PH_COUNT;
+  for(int ph=0;ph<PH_COUNT;ph++){
+    perfFormatRow(ph, row, sizeof(row)); drawText(10, (float)y, row, GLUT_BITMAP_8_BY_13); y -= 15;
+  }
+}
+
+static void renderScene(){
+  beginFrame(0.05f,0.05f,0.08f);
+
+  // MENU
+  if(current==MENU){
+    setColor(0.2f, 0.8f, 1.0f);
+    drawText(scrW/2.f-130, scrH-120, "DX-BALL [MODERN EDITION]");
+    const char* itemsResume[] = {"[ RESUME ]","[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
+    const char* itemsFresh[]  = {"[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
+    const char** items = canResume ? itemsResume : itemsFresh;
+    int itemCount = canResume ? 5 : 4;
+    for(int i=0;i<itemCount;i++){
+      float y = scrH/2.f + 60 - i*40.f;
+      if(i==menuIndex){ setColor(1.0f,0.9f,0.2f); drawText(scrW/2.f-90, y, std::string("> ")+items[i]); }
+      else { setColor(0.2f, 0.8f, 1.0f); drawText(scrW/2.f-70, y, items[i]); }
+    }
+    loadBest();
+    if(haveBest){
+      char b[96]; std::snprintf(b,sizeof(b),"BEST: %d PTS IN %.1FS", bestScore, bestTime);
+      setColor(0.3f,1.0f,0.3f); drawText(scrW/2.f-130, scrH/2.f-140, b);
+    }
+    if(!levelPack.empty()){
+      float tw = 240.f, th = thumbAtlas.tw ? tw*thumbAtlas.th/thumbAtlas.tw : tw*scrH/scrW;
+      float cx = scrW-150.f, cy = scrH/2.f;
+      char lb[64]; std::snprintf(lb, sizeof(lb), "< LEVEL %d/%d >", levelIndex+1, (int)levelPack.size());
+      setColor(0.2f, 0.8f, 1.0f); drawText(cx-tw/2.f, cy+th/2.f+30, lb);
+      drawText(cx-tw/2.f, cy+th/2.f+8, levelPack[levelIndex].name, GLUT_BITMAP_8_BY_13);
+      if(levelIndex < (int)thumbAtlas.x.size()) drawThumb(levelIndex, cx, cy, tw, th);
+      else { setColor(0.3f, 0.3f, 0.4f); drawRectOutline(cx, cy, tw, th); }
+    }
+    presentFrame(); return;
+  }
+
+  // HELP
+  if(current==HELP){
+    setColor(0.5f, 0.7f, 1.0f);
+    drawText(40, scrH-100, "HELP / CONTROLS:");
+    drawText(40, scrH-130, "MOUSE OR LEFT/RIGHT ARROW TO MOVE PADDLE");
+    drawText(40, scrH-155, "SPACE / LEFT CLICK: LAUNCH BALL");
+    drawText(40, scrH-180, "P OR ESC: PAUSE/RESUME");
+    drawText(40, scrH-205, "F OR RIGHT CLICK: FIRE BULLET (WHEN SHOOTING ACTIVE)");
+    drawText(40, scrH-235, "PERKS: LIFE(HEART), SPEED(BOLT), WIDE/SMALL PADDLE, THROUGH(RING),");
+    drawText(40, scrH-255, "      FIRE(FLAME), DEATH(SKULL), SHOOT(GUN)");
+    drawText(40, scrH-285, "GOAL: CLEAR ALL BRICKS AS FAST AS POSSIBLE.");
+    setColor(1.0f,0.9f,0.2f); drawText(40, scrH-315, "PRESS ENTER TO RETURN TO MENU.");
+    presentFrame(); return;
+  }
+
+  // HIGHSCORES
+  if(current==HIGHSCORES){
+    setColor(0.5f, 0.7f, 1.0f);
+    drawText(40, scrH-90, "HIGH SCORES (SCORE, TIME)");
+
+    std::vector<Run> rows = history;
+    std::sort(rows.begin(), rows.end(), [](const Run& a, const Run& b){
+      if(a.s != b.s) return a.s > b.s;
+      return a.t < b.t;
+    });
+
+    int y = scrH-130; int shown=0;
+    if(rows.empty()){
+      drawText(60, y, "NO SCORES YET");
+    } else {
+      for(size_t i=0;i<rows.size() && shown<15;i++){
+        char row[96];
+        std::snprintf(row,sizeof(row),"%2d) %6d PTS    %6.1FS", (int)i+1, rows[i].s, rows[i].t);
+        drawText(60, y, row); y -= 24; ++shown;
+      }
+    }
+
+    loadBest();
+    if(haveBest){
+      char b[96]; std::snprintf(b,sizeof(b),"BEST: %d PTS IN %.1FS", bestScore, bestTime);
+      setColor(0.3f,1.0f,0.3f); drawText(40, y-20, b);
+      setColor(0.5f, 0.7f, 1.0f);
+    }
+
+    setColor(1.0f,0.9f,0.2f); drawText(40, 60, "PRESS ENTER FOR MENU");
+    presentFrame(); return;
+  }
+
+  // GAME PLAY: draw bricks, paddle, ball, perks, bullets
+  // Bricks, perks and bullets are generated as parallel jobs into their own
+  // lists and merged in a fixed order: bricks, paddle, ball, perks, bullets.
+  perfMark(PH_R_BRICKS);
+  static DrawList brickCmds, paddleBallCmds, perkCmds, bulletCmds;
+  JobCounter kinds, merged;
+  if(brickCache) pushCmd(DRAW_BRICK_LAYER, 0.f,0.f,(float)scrW,(float)scrH);
+  else { const Brick* K=bricks.data(); size_t n=bricks.size(); jobRun(&kinds, [K,n]{ emitBricks(brickCmds, K, n); }); }
+  { const Perk* P=perks.data(); size_t n=perks.size(); float lead=slowAccum; jobRun(&kinds, [P,n,lead]{ emitPerks(perkCmds, P, n, lead); }); }
+  { const Bullet* B=bullets.data(); size_t n=bullets.size(); jobRun(&kinds, [B,n]{ emitBullets(bulletCmds, B, n); }); }
+
+  perfMark(PH_R_ENTITIES);
+  paddleBallCmds.cmds.clear(); paddleBallCmds.strings.clear(); drawTarget = &paddleBallCmds;
+  setColor(0.2f, 0.5f, 0.9f);
+  drawRectFilled(paddle.pos.x, paddle.pos.y, paddle.w, paddle.h);
+
+  if(ball.fireball) setColor(1.0f,0.45f,0.15f);
+  else if(ball.through) setColor(0.9f,0.2f,1.0f);
+  else setColor(0.3f, 1.0f, 0.3f);
+  drawCircleFilled(ball.pos.x, ball.pos.y, ball.radius, 32);
+  drawTarget = &frameList;
+
+  // Deterministic merge, released once every kind job has finished.
+  bool mergeBricks = !brickCache;
+  jobAfter(&kinds, &merged, [mergeBricks]{
+    if(mergeBricks) appendDrawList(frameList, brickCmds);
+    appendDrawList(frameList, paddleBallCmds);
+    appendDrawList(frameList, perkCmds);
+    appendDrawList(frameList, bulletCmds);
+  });
+  jobWait(&merged);
+
+  perfMark(PH_R_HUD);
+  renderHUD();
+
+  // PAUSE SCREEN WITH OPTIONS
+  if(current==PAUSE){
+    setColor(0.9f,0.9f,0.9f);
+    drawText(scrW/2.f-40, scrH/2.f + 60, "== PAUSED ==");
+
+    // Options: Resume, Exit to Main Menu
+    const char* opts[] = {"[ RESUME ]", "[ EXIT TO MAIN MENU ]"};
+    for(int i=0;i<2;i++){
+      if(i==pauseMenuIndex) setColor(1.0f,0.9f,0.2f);
+      else setColor(0.6f,0.8f,1.0f);
+      float y = scrH/2.f + 20 - i*40.f;
+      drawText(scrW/2.f - (i==0?50:140), y, opts[i]);
+    }
+    drawText(scrW/2.f-140, scrH/2.f - 120, "Use UP/DOWN to select, ENTER or Left-Click to confirm.");
+  }
+
+  if(current==WIN){ setColor(0.3f,1.0f,0.3f); drawText(scrW/2.f-80, scrH/2.f, "[ LEVEL CLEARED! ]"); drawText(scrW/2.f-120, scrH/2.f-30, "PRESS ENTER FOR MENU"); }
+  if(current==GAMEOVER){ setColor(1.0f,0.3f,0.3f); drawText(scrW/2.f-60, scrH/2.f, "[ GAME OVER ]"); drawText(scrW/2.f-120, scrH/2.f-30, "PRESS ENTER FOR MENU"); }
+
+  if(showProfiler) renderProfiler();
+  presentFrame();
+}
+
+// --- GLUT Callbacks ---
+
+static void onDisplay(){
+  renderScene();
+  if(metricsSeg){ static double prev = nowSec(); double t = nowSec(); metricsFrame(t - prev); prev = t; metricsPublish(); }
+}
+
+static void onIdle(){
+  if(current==PLAY){
+    static float prev = nowSec();
+    float t = nowSec(); float dt = t - prev; prev = t;
+    if(dt<0.f) dt=0.f; if(dt>REPLAY_MAX_DT) dt=REPLAY_MAX_DT;
+    recordTick(dt); updateGame(dt); perfMark(PH_NONE);
+    playTime += dt;
+    if(checkEvery) checkTick();
+  }
+  glutPostRedisplay();
+}
+
+// The playfield stays scrW x scrH whatever the window size (a replay holds no
+// window size), so a resize only rescales the projection.
+static void onReshape(int w,int h){
+  winW=std::max(1,w); winH=std::max(1,h); brickLayerStale=true; glViewport(0,0,w,h);
+  glMatrixMode(GL_PROJECTION); glLoadIdentity();
+  gluOrtho2D(0, (GLdouble)scrW, 0, (GLdouble)scrH);
+  glMatrixMode(GL_MODELVIEW); glLoadIdentity();
+}
+
+static void onKey(unsigned char key, int, int){
+  // Top-level MENU input
+  if(current==MENU){
+    if(key=='\r' || key=='\n'){
+      const char* itemsResume[] = {"[ RESUME ]","[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
+      const char* itemsFresh[]  = {"[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
+      const char** items = canResume ? itemsResume : itemsFresh;
+      int itemCount = canResume ? 5 : 4;
+      if(menuIndex>=0 && menuIndex<itemCount){
+        std::string it = items[menuIndex];
+        if(it=="[ RESUME ]" && canResume) current=PLAY;
+        else if(it=="[ START NEW GAME ]") newGame();
+        else if(it=="[ HIGH SCORES ]") current=HIGHSCORES;
+        else if(it=="[ HELP ]") current=HELP;
+        else if(it=="[ EXIT ]") std::exit(0);
+      }
+    }
+    if(key==27) std::exit(0);
+    return;
+  }
+
+  // HELP or HIGHSCORES return to menu
+  if(current==HELP || current==HIGHSCORES){
+    if(key=='\r' || key=='\n' || key==27) current=MENU;
+    return;
+  }
+
+  // WIN or GAMEOVER: Enter -> menu
+  if(current==WIN || current==GAMEOVER){
+    if(key=='\r' || key=='\n') current=MENU;
+    return;
+  }
+
+  // Toggle Pause (P or Esc)
+  if(key==27 || key=='p' || key=='P'){
+    if(current==PLAY){ current=PAUSE; canResume=true; pauseMenuIndex=0; }
+    else if(current==PAUSE){ current=PLAY; }
+    return;
+  }
+
+  // If paused, allow keyboard selection
+  if(current==PAUSE){
+    if(key=='\r' || key=='\n'){
+      if(pauseMenuIndex==0){ current=PLAY; }
+      else if(pauseMenuIndex==1){ exitToMenu(); }
+    }
+    // also support single-key shortcuts
+    if(key=='r' || key=='R'){ current=PLAY; }
+    if(key=='e' || key=='E'){ exitToMenu(); }
+    return;
+  }
+
+  if(current!=PLAY) return;
+
+  // Launch Ball
+  if(key==' ' && ball.stuck) playerInput(IN_LAUNCH_KEY);
+  // Fire Bullet
+  if(key=='f' || key=='F') playerInput(IN_FIRE);
+}
+
+static void onSpKey(int key,int,int){
+  if(key==GLUT_KEY_F3){ showProfiler = !showProfiler; return; }
+  // Menu navigation
+  if(current==MENU){
+    int itemCount = canResume ? 5 : 4;
+    if(key==GLUT_KEY_UP){ menuIndex = (menuIndex - 1 + itemCount) % itemCount; }
+    if(key==GLUT_KEY_DOWN){ menuIndex = (menuIndex + 1) % itemCount; }
+    int nLevels = (int)levelPack.size();
+    if(nLevels && key==GLUT_KEY_LEFT){ levelIndex = (levelIndex - 1 + nLevels) % nLevels; }
+    if(nLevels && key==GLUT_KEY_RIGHT){ levelIndex = (levelIndex + 1) % nLevels; }
+    return;
+  }
+// Pause menu navigation
+  if(current==PAUSE){
+    if(key==GLUT_KEY_UP){ pauseMenuIndex = (pauseMenuIndex - 1 + 2) % 2; }
+    if(key==GLUT_KEY_DOWN){ pauseMenuIndex = (pauseMenuIndex + 1) % 2; }
+    return;
+  }
+  // In gameplay, movement keys
+  if(current!=PLAY) return;
+  if(key==GLUT_KEY_LEFT) playerInput(IN_LEFT, 1.f);
+  if(key==GLUT_KEY_RIGHT) playerInput(IN_RIGHT, 1.f);
+}
+
+static void onSpKeyUp(int key,int,int){
+  if(key==GLUT_KEY_LEFT) playerInput(IN_LEFT, 0.f);
+  if(key==GLUT_KEY_RIGHT) playerInput(IN_RIGHT, 0.f);
+}
+
+static void onMouse(int button,int state,int x,int y){
+  // Convert GLUT y to window coords (we use 0..scrH)
+  int wy = scrH - y;
+  if(current==MENU){
+    if(button==GLUT_LEFT_BUTTON && state==GLUT_DOWN){
+      const char* itemsResume[] = {"[ RESUME ]","[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
+      const char* itemsFresh[]  = {"[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
+      const char** items = canResume ? itemsResume : itemsFresh;
+      int itemCount = canResume ? 5 : 4;
+      if(menuIndex>=0 && menuIndex<itemCount){
+        std::string it = items[menuIndex];
+        if(it=="[ RESUME ]" && canResume) current=PLAY;
+        else if(it=="[ START NEW GAME ]") newGame();
+        else if(it=="[ HIGH SCORES ]") current=HIGHSCORES;
+        else if(it=="[ HELP ]") current=HELP;
+        else if(it=="[ EXIT ]") std::exit(0);
+      }
+    }
+    return;
+  }
+
+  if(current==PAUSE){
+    if(button==GLUT_LEFT_BUTTON && state==GLUT_DOWN){
+      // Treat left-click as Enter: select highlighted option
+      if(pauseMenuIndex==0){ current=PLAY; }
+      else if(pauseMenuIndex==1){ exitToMenu(); }
+    }
+    return;
+  }
+
+  if(current==PLAY){
+    if(ball.stuck && button==GLUT_LEFT_BUTTON && state==GLUT_DOWN){
+      playerInput(IN_LAUNCH_MOUSE);
+    }
+    if(button==GLUT_RIGHT_BUTTON && state==GLUT_DOWN){
+      playerInput(IN_FIRE);
+    }
+  }
+}
+
+static void onMotion(int x,int y){ (void)y;
+  if(current==PLAY) playerInput(IN_PADDLE_X, (float)x*scrW/winW);
+}
+static void onPassiveMotion(int x,int y){ onMotion(x,y); }
+
+// --- Columnar Trace ---
+// --trace FILE records every headless tick, one column per field. The sim
+// thread only copies raw floats into a chunk (traceTick); a writer thread
+// quantizes each column (fixed point at the column's scale), takes order-1
+// or order-2 deltas, zigzags them and bit-packs blocks of 128 with the width
+// that minimizes size, storing the few values that do not fit as
+// exceptions (patched frame of reference). Chunks and columns are
+// independently decodable, and a directory at the end gives their offsets,
+// so readers can mmap the file and touch only what they need.
+//
+// Layout: TraceHeader, TraceColumn[columns], chunk payloads, then at
+// dirOffset for each chunk: TraceChunkDir, {offset, bytes}[columns].
+// Block: u8 width, u8 exceptions, 128*width bits (LSB first), then
+// exceptions as u8 index + LEB128 zigzag residual.
+struct TraceHeader   { char magic[4]; uint32_t version, columns, chunkTicks; uint64_t ticks, chunks, dirOffset; };
+struct TraceColumn   { char name[16]; float scale; uint32_t order; };
+struct TraceChunkDir { uint64_t firstTick; uint32_t ticks, pad; };
+
+static const TraceColumn traceCols[] = {
+  {"game", 1.f, 1}, {"ball_x", 64.f, 2}, {"ball_y", 64.f, 2}, {"ball_vx", 16.f, 1}, {"ball_vy", 16.f, 1},
+  {"ball_speed", 16.f, 1}, {"paddle_x", 64.f, 1}, {"paddle_w", 64.f, 1}, {"effects", 1.f, 1}, {"bricks", 1.f, 1},
+};
+static const int TRACE_COLS = (int)(sizeof(traceCols)/sizeof(traceCols[0]));
+static const int TRACE_CHUNK = 16384, TRACE_BLOCK = 128;
+
+struct TraceChunk { float col[TRACE_COLS][TRACE_CHUNK]; uint32_t n; uint64_t first; };
+
+static FILE*                    traceFile = nullptr;
+static TraceChunk*              traceCur = nullptr;
+static uint64_t                 traceTicks = 0;
+static std::vector<TraceChunk*> traceQueue, traceSpare;
+static std::vector<uint64_t>    traceDir;     // per chunk: firstTick, ticks, then offset/bytes per column
+static std::mutex               traceMx;
+static std::condition_variable  traceCv;
+static bool                     traceClosing = false;
+static std::thread              traceThread;
+
+static inline uint8_t* traceVarint(uint8_t* o, uint64_t v){
+  while(v >= 0x80){ *o++ = (uint8_t)(v | 0x80); v >>= 7; }
+  *o++ = (uint8_t)v; return o;
+}
+
+// Encodes n values at o (room for traceBound(n) bytes) and returns the end.
+// Bits are packed LSB first; widths up to 32 go through a 32-bit flush
+// (little-endian stores), wider ones byte by byte.
+static size_t traceBound(uint32_t n){ return (size_t)(n/TRACE_BLOCK + 1)*(2 + 8*TRACE_BLOCK + 4 + 11*TRACE_BLOCK); }
+static uint8_t* traceEncode(const float* v, uint32_t n, const TraceColumn& c, uint8_t* o){
+  int64_t p1=0, p2=0; uint64_t z[TRACE_BLOCK];
+  for(uint32_t b=0; b<n; b+=TRACE_BLOCK){
+    int m = (int)std::min<uint32_t>(TRACE_BLOCK, n-b), hist[65] = {0};
+    for(int k=0;k<m;k++){
+      double t = (double)v[b+k]*c.scale;
+      int64_t q = (int64_t)(t + (t >= 0.0 ? 0.5 : -0.5));
+      int64_t r = q - (c.order==2 ? 2*p1-p2 : p1); p2=p1; p1=q;
+      z[k] = ((uint64_t)r << 1) ^ (uint64_t)(r >> 63);
+      hist[z[k] ? 64-__builtin_clzll(z[k]) : 0]++;
+    }
+    // width w: m*w bits plus ~40 bits per exception (a value wider than w)
+    int w=64, over=0; long best=1L<<62;
+    for(int x=64; x>=0; x--){
+      long cost = (long)m*x + 40L*over; if(cost <= best){ best=cost; w=x; }
+      over += hist[x];
+    }
+    uint8_t* hdr = o; o += 2; uint64_t acc=0; int bits=0, nexc=0;
+    const uint64_t lim = w==64 ? ~0ull : (1ull<<w)-1;
+    if(w <= 32){
+      for(int k=0;k<m;k++){
+        acc |= (z[k] <= lim ? z[k] : 0) << bits; bits += w;
+        if(bits >= 32){ uint32_t lo = (uint32_t)acc; std::memcpy(o, &lo, 4); o += 4; acc >>= 32; bits -= 32; }
+      }
+    } else {
+      for(int k=0;k<m;k++){
+        uint64_t x = z[k] <= lim ? z[k] : 0;
+        for(int left=w; left>0; ){   // bits < 8 here, so one pass takes at least 56 bits
+          int take = std::min(left, 64-bits);
+          acc |= (take==64 ? x : x & ((1ull<<take)-1)) << bits; bits += take; left -= take; x = take==64 ? 0 : x >> take;
+          while(bits >= 8){ *o++ = (uint8_t)acc; acc >>= 8; bits -= 8; }
+        }
+      }
+    }
+    for(; bits > 0; bits -= 8){ *o++ = (uint8_t)acc; acc >>= 8; }
+    for(int k=0;k<m;k++) if(z[k] > lim){ *o++ = (uint8_t)k; o = traceVarint(o, z[k]); nexc++; }
+    hdr[0] = (uint8_t)w; hdr[1] = (uint8_t)nexc;
+  }
+  return o;
+}
+
+static void traceWriterLoop(){
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[traceBound(TRACE_CHUNK)]);
+  for(;;){
+    TraceChunk* ch;
+    { std::unique_lock<std::mutex> g(traceMx);
+      traceCv.wait(g, []{ return !traceQueue.empty() || traceClosing; });
+      if(traceQueue.empty()) return;
+      ch = traceQueue.front(); traceQueue.erase(traceQueue.begin()); }
+    std::vector<uint64_t> dir = {ch->first, ch->n};
+    for(int c=0;c<TRACE_COLS;c++){
+      size_t len = (size_t)(traceEncode(ch->col[c], ch->n, traceCols[c], buf.get()) - buf.get());
+      dir.push_back((uint64_t)std::ftell(traceFile)); dir.push_back(len);
+      std::fwrite(buf.get(), 1, len, traceFile);
+    }
+    std::lock_guard<std::mutex> g(traceMx);
+    traceDir.insert(traceDir.end(), dir.begin(), dir.end());
+    traceSpare.push_back(ch);
+  }
+}
 
-  // Check for Win Condition
-  bool any=false; for(size_t i=0;i<bricks.size();++i){ if(bricks[i].alive){ any=true; break; } }
-  if(!any){ current=WIN; saveHighScore(); canResume=false; }
+static bool traceStart(const std::string& path){
+  traceFile = std::fopen(path.c_str(), "wb");
+  if(!traceFile){ std::fprintf(stderr, "trace: cannot write %s\n", path.c_str()); return false; }
+  TraceHeader h; std::memset(&h, 0, sizeof(h));
+  std::fwrite(&h, sizeof(h), 1, traceFile);                       // patched in traceFinish()
+  std::fwrite(traceCols, sizeof(TraceColumn), TRACE_COLS, traceFile);
+  traceCur = new TraceChunk(); traceCur->n = 0; traceCur->first = 0;
+  traceThread = std::thread(traceWriterLoop);
+  return true;
 }
-// --- Rendering Functions for Modern Filled UI ---
 
-static void drawPerkIcon(PerkType t,float x,float y,float s){
-  glPushMatrix(); glTranslatef(x,y,0); glScalef(s,s,1);
-  glBegin(GL_LINES);
-  switch(t){
-    case EXTRA_LIFE: glColor3f(1.0f,0.2f,0.2f);
-      glVertex2f(-0.5f, 0.2f); glVertex2f( 0.0f, 0.8f);
-      glVertex2f( 0.5f, 0.2f); glVertex2f( 0.0f, 0.8f);
-      glVertex2f(-0.5f, 0.2f); glVertex2f( 0.5f, 0.2f);
-      break;
-    case SPEED_UP: glColor3f(0.9f,0.9f,0.2f);
-      glVertex2f(-0.5f, -0.5f); glVertex2f( 0.0f, 0.5f);
-      glVertex2f( 0.5f, -0.5f); glVertex2f( 0.0f, 0.5f);
-      glVertex2f(-0.3f, 0.0f); glVertex2f( 0.3f, 0.0f);
-      break;
-    case WIDE_PADDLE: glColor3f(0.3f,1.0f,0.3f); glVertex2f(-0.9f, 0.0f); glVertex2f( 0.9f, 0.0f); break;
-    case SHRINK_PADDLE: glColor3f(1.0f,0.5f,0.1f); glVertex2f(-0.4f, 0.0f); glVertex2f( 0.4f, 0.0f); break;
-    case THROUGH_BALL: glColor3f(0.2f,0.8f,1.0f);
-      glVertex2f(0.0f, 0.8f); glVertex2f(-0.8f, 0.0f);
-      glVertex2f(-0.8f, 0.0f); glVertex2f(0.0f, -0.8f);
-      glVertex2f(0.0f, -0.8f); glVertex2f(0.8f, 0.0f);
-      glVertex2f(0.8f, 0.0f); glVertex2f(0.0f, 0.8f);
-      break;
-    case FIREBALL: glColor3f(1.0f,0.4f,0.0f);
-      glVertex2f(-0.5f, -0.5f); glVertex2f( 0.5f, 0.5f);
-      glVertex2f( 0.5f, -0.5f); glVertex2f(-0.5f, 0.5f);
-      break;
-    case INSTANT_DEATH: glColor3f(0.8f,0.0f,0.8f);
-      glVertex2f(-0.6f, 0.6f); glVertex2f( 0.6f, -0.6f);
-      glVertex2f( 0.6f, 0.6f); glVertex2f(-0.6f, -0.6f);
-      break;
-    case SHOOTING_PADDLE: glColor3f(0.9f,0.9f,0.2f);
-      glVertex2f(0.0f, -0.5f); glVertex2f( 0.0f, 0.5f);
-      glVertex2f(-0.3f, 0.5f); glVertex2f( 0.3f, 0.5f);
-      break;
+static void traceFlush(){
+  if(!traceCur->n) return;
+  std::lock_guard<std::mutex> g(traceMx);
+  traceQueue.push_back(traceCur);
+  if(traceSpare.empty()) traceCur = new TraceChunk(); else { traceCur = traceSpare.back(); traceSpare.pop_back(); }
+  traceCur->n = 0; traceCur->first = traceTicks;
+  traceCv.notify_one();
+}
+
+static inline void traceTick(int game){
+  TraceChunk& c = *traceCur; uint32_t i = c.n;
+  c.col[0][i] = (float)game;
+  c.col[1][i] = ball.pos.x; c.col[2][i] = ball.pos.y; c.col[3][i] = ball.vel.x; c.col[4][i] = ball.vel.y;
+  c.col[5][i] = ball.speed; c.col[6][i] = paddle.pos.x; c.col[7][i] = paddle.w;
+  c.col[8][i] = (float)((int)ball.through | (int)ball.fireball<<1 | (int)paddle.shooting<<2 | (int)(paddle.w!=120.f)<<3);
+  c.col[9][i] = (float)bricksAlive;
+  c.n = i+1; ++traceTicks;
+  if(c.n == (uint32_t)TRACE_CHUNK) traceFlush();
+}
+
+static void traceFinish(){
+  if(!traceFile) return;
+  traceFlush();
+  { std::lock_guard<std::mutex> g(traceMx); traceClosing = true; }
+  traceCv.notify_one(); traceThread.join();
+  TraceHeader h; std::memcpy(h.magic, "DXT1", 4); h.version = 1; h.columns = TRACE_COLS; h.chunkTicks = TRACE_CHUNK;
+  h.ticks = traceTicks; h.chunks = traceDir.size()/(2+2*TRACE_COLS); h.dirOffset = (uint64_t)std::ftell(traceFile);
+  for(size_t k=0; k<traceDir.size(); k += 2+2*TRACE_COLS){
+    TraceChunkDir d = {traceDir[k], (uint32_t)traceDir[k+1], 0};
+    std::fwrite(&d, sizeof(d), 1, traceFile);
+    std::fwrite(&traceDir[k+2], sizeof(uint64_t), 2*TRACE_COLS, traceFile);
   }
-  glEnd();
-  glPopMatrix();
+  std::fseek(traceFile, 0, SEEK_SET); std::fwrite(&h, sizeof(h), 1, traceFile);
+  std::fclose(traceFile); traceFile = nullptr;
+  for(TraceChunk* c : traceSpare) delete c;
+  delete traceCur; traceSpare.clear(); traceCur = nullptr;
 }
 
-static void renderHUD(){
-  glColor3f(0.9f, 0.9f, 0.9f);
-  drawText(10, scrH-24, std::string("SCORE: ")+std::to_string(score));
-  drawText(10, scrH-48, std::string("LIVES: ")+std::to_string(lives));
+// Decodes one column of one chunk into out (ticks values, in column units).
+static void traceDecode(const uint8_t* p, uint32_t n, const TraceColumn& c, std::vector<double>& out){
+  out.resize(n); int64_t p1=0, p2=0; uint64_t z[TRACE_BLOCK];
+  for(uint32_t b=0; b<n; b+=TRACE_BLOCK){
+    int m = (int)std::min<uint32_t>(TRACE_BLOCK, n-b), w = *p++, nexc = *p++;
+    uint64_t acc=0; int bits=0;
+    for(int k=0;k<m;k++){
+      uint64_t x=0; int got=0;
+      while(got < w){
+        if(bits==0){ acc = *p++; bits = 8; }
+        int take = std::min(w-got, bits);
+        x |= (acc & ((1ull<<take)-1)) << got; acc >>= take; bits -= take; got += take;
+      }
+      z[k] = x;
+    }
+    for(int e=0;e<nexc;e++){
+      int k = *p++; uint64_t v=0; int sh=0;
+      do { v |= (uint64_t)(*p & 0x7f) << sh; sh += 7; } while(*p++ & 0x80);
+      z[k] = v;
+    }
+    for(int k=0;k<m;k++){
+      int64_t r = (int64_t)(z[k] >> 1) ^ -(int64_t)(z[k] & 1);
+      int64_t q = r + (c.order==2 ? 2*p1-p2 : p1); p2=p1; p1=q;
+      out[b+k] = q / (double)c.scale;
+    }
+  }
+}
 
-  float tNow=nowSec(); if(current==PLAY) playTime += (tNow-lastTick); lastTick=tNow;
-  char buf[64]; std::snprintf(buf,sizeof(buf),"TIME: %.1fs", playTime);
-  drawText(scrW-160, scrH-24, buf);
+// --trace-dump FILE: maps a trace and prints per-column size and range.
+static int runTraceDump(const std::string& path){
+#ifdef __linux__
+  int fd = open(path.c_str(), O_RDONLY); struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0){ std::perror("trace-dump"); return 1; }
+  size_t bytes = (size_t)st.st_size;
+  const uint8_t* base = bytes ? (const uint8_t*)mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0) : nullptr; close(fd);
+  if(!base || base==(const uint8_t*)MAP_FAILED || bytes < sizeof(TraceHeader)){ std::fprintf(stderr, "trace-dump: cannot map %s\n", path.c_str()); return 1; }
+  const TraceHeader* h = (const TraceHeader*)base;
+  if(std::memcmp(h->magic, "DXT1", 4) || h->dirOffset > bytes){ std::fprintf(stderr, "trace-dump: %s is not a trace\n", path.c_str()); return 1; }
+  const TraceColumn* cols = (const TraceColumn*)(h+1);
+  std::printf("trace: %llu ticks, %llu chunks, %u columns, %zu bytes (%.2f bytes/tick)\n",
+              (unsigned long long)h->ticks, (unsigned long long)h->chunks, h->columns, bytes, h->ticks ? (double)bytes/h->ticks : 0.0);
+  std::vector<double> v;
+  for(uint32_t c=0;c<h->columns;c++){
+    uint64_t colBytes=0; double lo=1e300, hi=-1e300;
+    const uint8_t* d = base + h->dirOffset;
+    for(uint64_t k=0;k<h->chunks;k++){
+      const TraceChunkDir* cd = (const TraceChunkDir*)d; const uint64_t* ob = (const uint64_t*)(cd+1);
+      traceDecode(base + ob[2*c], cd->ticks, cols[c], v); colBytes += ob[2*c+1];
+      for(double x : v){ lo = std::min(lo,x); hi = std::max(hi,x); }
+      d += sizeof(TraceChunkDir) + 2*sizeof(uint64_t)*h->columns;
+    }
+    std::printf("  %-11s order=%u scale=%-4g %9llu bytes %6.2f bits/tick  range [%g, %g]\n", cols[c].name, cols[c].order, cols[c].scale,
+                (unsigned long long)colBytes, h->ticks ? colBytes*8.0/h->ticks : 0.0, lo, hi);
+  }
+  munmap((void*)base, bytes);
+  return 0;
+#else
+  std::fprintf(stderr, "--trace-dump: only supported on Linux\n"); (void)path;
+  return 1;
+#endif
+}
 
-  int y = scrH-72; char pbuf[64];
-  glColor3f(1.0f, 0.9f, 0.2f);
-  if(ball.through){ std::snprintf(pbuf,sizeof(pbuf),"THROUGH: %ds", (int)std::ceil(ball.throughTimer)); drawText(scrW-200,y,pbuf); y-=22; }
-  if(ball.fireball){ std::snprintf(pbuf,sizeof(pbuf),"FIREBALL: %ds", (int)std::ceil(ball.fireballTimer)); drawText(scrW-200,y,pbuf); y-=22; }
-  if(paddle.shooting){ std::snprintf(pbuf,sizeof(pbuf),"SHOOTING: %ds", (int)std::ceil(paddle.shootingTimer)); drawText(scrW-200,y,pbuf); y-=22; }
+// --- Headless Simulation ---
+// Simple tracking policy standing in for the player: follow the ball, launch when stuck.
+static void autopilot(){
+  float target = ball.pos.x;
+  bool wantL = target < paddle.pos.x - 4.f, wantR = !wantL && target > paddle.pos.x + 4.f;
+  if(wantL != leftHeld)  playerInput(IN_LEFT,  wantL ? 1.f : 0.f);
+  if(wantR != rightHeld) playerInput(IN_RIGHT, wantR ? 1.f : 0.f);
+  if(ball.stuck) playerInput(IN_LAUNCH_KEY);
 }
 
-static void renderScene(){
-  glClearColor(0.05f,0.05f,0.08f,1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
+// Predictive policy: while the ball falls, head for where it will cross the
+// paddle line (walls folded in); otherwise stay put. The target only changes
+// when the ball's path does, so it behaves the same under large event steps.
+static float predictTarget(){
+  if(ball.stuck || ball.vel.y >= 0.f) return paddle.pos.x;
+  float land = paddle.pos.y + paddle.h/2.f + ball.radius;
+  float t = (ball.pos.y - land) / -ball.vel.y; if(t < 0.f) t = 0.f;
+  float lo = ball.radius, span = scrW - 2.f*ball.radius;
+  float u = std::fmod(ball.pos.x + ball.vel.x*t - lo, 2.f*span); if(u < 0.f) u += 2.f*span;
+  return lo + (u > span ? 2.f*span - u : u);
+}
 
-  // MENU
-  if(current==MENU){
-    glColor3f(0.2f, 0.8f, 1.0f);
-    drawText(scrW/2.f-130, scrH-120, "DX-BALL [MODERN EDITION]");
-    const char* itemsResume[] = {"[ RESUME ]","[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
-    const char* itemsFresh[]  = {"[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
-    const char** items = canResume ? itemsResume : itemsFresh;
-    int itemCount = canResume ? 5 : 4;
-    for(int i=0;i<itemCount;i++){
-      float y = scrH/2.f + 60 - i*40.f;
-      if(i==menuIndex){ glColor3f(1.0f,0.9f,0.2f); drawText(scrW/2.f-90, y, std::string("> ")+items[i]); }
-      else { glColor3f(0.2f, 0.8f, 1.0f); drawText(scrW/2.f-70, y, items[i]); }
+static void autopilotPredict(){
+  float target = predictTarget();
+  bool wantL = target < paddle.pos.x - 4.f, wantR = !wantL && target > paddle.pos.x + 4.f;
+  if(wantL != leftHeld)  playerInput(IN_LEFT,  wantL ? 1.f : 0.f);
+  if(wantR != rightHeld) playerInput(IN_RIGHT, wantR ? 1.f : 0.f);
+  if(ball.stuck) playerInput(IN_LAUNCH_KEY);
+}
+
+static const float HEADLESS_DT = 1.f/120.f;
+static const float HEADLESS_MAX_TIME = 600.f;
+
+// --- Event Stepping ---
+// Between contacts every body moves in a straight line, so instead of fixed
+// ticks the headless loop can jump to the earliest time of impact: walls,
+// paddle (swept against its current velocity), bricks from the broadphase,
+// perks and bullets, a perk timer running out, or the paddle reaching its
+// target. Steps are rounded up to whole HEADLESS_DT ticks, so a contact is
+// met with the same penetration the tick loop would see, and while something
+// is already in contact (through-ball, perk pickup) the step is a single tick.
+// Bricks are assumed static: while any brick has an on_tick handler (which
+// may move it, and expects to run every tick) every step is a single tick.
+static const float EVENT_MAX_DT = 0.25f;
+static const float EVENT_NONE   = 1e30f;
+
+// Earliest t >= 0 at which a point moving from p with velocity v enters the
+// rectangle (cx,cy,hw,hh) grown by radius r (rounded corners), or EVENT_NONE.
+static float sweepRoundRect(Vec2 p, Vec2 v, float cx,float cy,float hw,float hh, float r){
+  float best = EVENT_NONE;
+  const float ex[2]={hw+r, hw}, ey[2]={hh, hh+r};
+  for(int k=0;k<2;k++){  // two slab-expanded rectangles
+    float t0=0.f, t1=EVENT_NONE; bool ok=true;
+    const float lo[2]={cx-ex[k], cy-ey[k]}, hi[2]={cx+ex[k], cy+ey[k]}, o[2]={p.x,p.y}, d[2]={v.x,v.y};
+    for(int a=0;a<2 && ok;a++){
+      if(std::fabs(d[a]) < 1e-9f){ if(o[a]<lo[a] || o[a]>hi[a]) ok=false; continue; }
+      float ta=(lo[a]-o[a])/d[a], tb=(hi[a]-o[a])/d[a]; if(ta>tb) std::swap(ta,tb);
+      t0=std::max(t0,ta); t1=std::min(t1,tb); if(t0>t1) ok=false;
     }
-    loadBest();
-    if(haveBest){
-      char b[96]; std::snprintf(b,sizeof(b),"BEST: %d PTS IN %.1FS", bestScore, bestTime);
-      glColor3f(0.3f,1.0f,0.3f); drawText(scrW/2.f-130, scrH/2.f-140, b);
+    if(ok) best = std::min(best, t0);
+  }
+  float vv = dot(v,v);
+  if(vv > 1e-9f) for(int k=0;k<4;k++){  // corner circles
+    Vec2 q = p - Vec2{cx + ((k&1)?hw:-hw), cy + ((k&2)?hh:-hh)};
+    float b = dot(q,v), c = dot(q,q) - r*r, disc = b*b - vv*c;
+    if(b < 0.f && disc >= 0.f){ float t = (-b - std::sqrt(disc))/vv; best = std::min(best, t<0.f?0.f:t); }
+  }
+  return best;
+}
+
+static float nextEventDt(){
+  if(!tickBricks.empty()) return HEADLESS_DT;
+  float t = EVENT_MAX_DT;
+  t = std::min(t, fxNextDue());
+
+  // Paddle: until it stops at the wall clamp or reaches the policy's target.
+  float pvx=0.f; if(leftHeld) pvx -= paddle.speed; if(rightHeld) pvx += paddle.speed;
+  if(pvx != 0.f){
+    float edge = pvx<0.f ? paddle.w/2.f+6.f : scrW - paddle.w/2.f - 6.f;
+    float toEdge = (edge - paddle.pos.x)/pvx; if(toEdge > 0.f) t = std::min(t, toEdge);
+    float gap = std::fabs(predictTarget() - paddle.pos.x) - 4.f;
+    if(gap > 0.f) t = std::min(t, gap/paddle.speed);
+  }
+
+  if(!ball.stuck){
+    Vec2 p = ball.pos, v = ball.vel; float R = ball.radius;
+    if(aabbCircleCollision(paddle.pos.x,paddle.pos.y,paddle.w,paddle.h, p, R, nullptr,nullptr)) return HEADLESS_DT;
+    if(v.x < 0.f) t = std::min(t, (p.x - R)/-v.x);
+    if(v.x > 0.f) t = std::min(t, (scrW - R - p.x)/v.x);
+    if(v.y > 0.f) t = std::min(t, (scrH - R - p.y)/v.y);
+    if(v.y < 0.f) t = std::min(t, (p.y - R)/-v.y);
+    t = std::min(t, sweepRoundRect(p, Vec2{v.x - pvx, v.y}, paddle.pos.x,paddle.pos.y, paddle.w/2.f,paddle.h/2.f, R));
+    static thread_local std::vector<int> near;
+    Vec2 e = p + v*t;
+    gridQuery(std::min(p.x,e.x)-R, std::min(p.y,e.y)-R, std::max(p.x,e.x)+R, std::max(p.y,e.y)+R, near);
+    for(int i : near){ const Brick& b = bricks[i];
+      if(aabbCircleCollision(b.x,b.y,b.w,b.h, p, R, nullptr,nullptr)) return HEADLESS_DT;
+      t = std::min(t, sweepRoundRect(p, v, b.x,b.y, b.w/2.f,b.h/2.f, R)); }
+  }
+
+  for(const Perk& pk : perks){ if(!pk.alive || pk.vel.y >= 0.f) continue;
+    float band = paddle.pos.y + paddle.h/2.f + pk.size/2.f;
+    if(pk.pos.y <= band && pk.pos.y >= paddle.pos.y - paddle.h/2.f - pk.size/2.f) return HEADLESS_DT;
+    if(pk.pos.y > band) t = std::min(t, (pk.pos.y - band)/-pk.vel.y);
+    t = std::min(t, (pk.pos.y + 30.f)/-pk.vel.y);
+  }
+
+  float top = scrH+20.f;
+  for(const Bullet& bu : bullets){ if(!bu.alive || bu.vel.y <= 0.f) continue;
+    t = std::min(t, (top - bu.pos.y)/bu.vel.y);
+    static thread_local std::vector<int> col;
+    gridQuery(bu.pos.x, bu.pos.y, bu.pos.x, bu.pos.y + bu.vel.y*t, col);
+    for(int i : col){ const Brick& b = bricks[i];
+      if(std::fabs(bu.pos.x - b.x) > b.w/2.f) continue;
+      float lo = b.y - b.h/2.f; if(bu.pos.y >= lo) return HEADLESS_DT;
+      t = std::min(t, (lo - bu.pos.y)/bu.vel.y); }
+  }
+  return HEADLESS_DT * std::max(1.f, std::ceil(t/HEADLESS_DT));
+}
+
+// events: step with nextEventDt() instead of HEADLESS_DT (implies predict).
+static int runHeadless(int games, unsigned seed, bool predict, bool events){
+  rng.seed(seed);
+  long long ticks=0; int wins=0;
+  auto t0 = std::chrono::steady_clock::now(), block = t0;
+  for(int g=0; g<games; g++){
+    newGame();
+    while(current==PLAY && playTime < HEADLESS_MAX_TIME){
+      if(predict || events) autopilotPredict(); else autopilot();
+      float dt = events ? nextEventDt() : HEADLESS_DT;
+      recordTick(dt); updateGame(dt); perfMark(PH_NONE);
+      playTime += dt; ++ticks;
+      if(traceFile) traceTick(g);
+      if(checkEvery) checkTick();
+      if(metricsSeg && (ticks & 63)==0){  // tick time is averaged over 64-tick blocks to keep clock reads off the hot path
+        auto now = std::chrono::steady_clock::now();
+        metricsFrame(std::chrono::duration<double>(now-block).count()/64.0); block = now; metricsPublish();
+      }
     }
-    glutSwapBuffers(); return;
+    if(current==WIN) ++wins;
+    if(current==PLAY) saveHighScore();  // time cap reached
+    std::printf("game %d: %s score=%d lives=%d time=%.1fs\n", g,
+                current==WIN ? "WIN" : current==GAMEOVER ? "GAMEOVER" : "TIMEOUT", score, lives, playTime);
   }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  std::printf("summary: games=%d wins=%d ticks=%lld wall=%.3fs ticks/s=%.0f\n",
+              games, wins, ticks, wall, wall>0 ? ticks/wall : 0.0);
+  traceFinish();
+  heatFinish(games);
+  checkFinish();
+  perfPrintSummary(stdout);
+  return 0;
+}
 
-  // HELP
-  if(current==HELP){
-    glColor3f(0.5f, 0.7f, 1.0f);
-    drawText(40, scrH-100, "HELP / CONTROLS:");
-    drawText(40, scrH-130, "MOUSE OR LEFT/RIGHT ARROW TO MOVE PADDLE");
-    drawText(40, scrH-155, "SPACE / LEFT CLICK: LAUNCH BALL");
-    drawText(40, scrH-180, "P OR ESC: PAUSE/RESUME");
-    drawText(40, scrH-205, "F OR RIGHT CLICK: FIRE BULLET (WHEN SHOOTING ACTIVE)");
-    drawText(40, scrH-235, "PERKS: LIFE(HEART), SPEED(BOLT), WIDE/SMALL PADDLE, THROUGH(RING),");
-    drawText(40, scrH-255, "      FIRE(FLAME), DEATH(SKULL), SHOOT(GUN)");
-    drawText(40, scrH-285, "GOAL: CLEAR ALL BRICKS AS FAST AS POSSIBLE.");
-    glColor3f(1.0f,0.9f,0.2f); drawText(40, scrH-315, "PRESS ENTER TO RETURN TO MENU.");
-    glutSwapBuffers(); return;
+// --- State Forking ---
+// Lookahead search and replay analysis clone the game thousands of times per
+// decision. A GameState is an immutable snapshot of everything updateGame()
+// reads or writes, kept in pages allocated from a StateArena: bricks in pages
+// of STATE_BRICK_PAGE, perks and bullets in pages of STATE_ENTITY_PAGE, and
+// the effect wheel and the rng in one page each. Pages are never written once
+// captured, so copying a GameState forks it in O(1) and states on any thread
+// can share them. The replay being recorded, wall-clock times and profiler
+// counters are not part of the state.
+//
+// The live game remembers the state it was last captured to or restored from.
+// A capture shares every page the game has not written since: bricks by the
+// touched bitmap, the wheel by fxVersion, perks, bullets and the rng by
+// comparison. A restore copies only pages that differ from it, and re-files
+// in the broadphase only the bricks that moved, died or came back.
+//
+// Abandoned branches are reclaimed in bulk by resetting their arena. States
+// captured after restoring a state share its pages, so an arena must outlive
+// every state derived from its own. A reset or destroyed arena bumps
+// stateEpoch, which makes every thread's next capture and restore a full copy.
+static const int STATE_ENTITY_PAGE = 32;
+static std::atomic<uint32_t> stateEpoch(0);
+
+struct StateArena {
+  static const size_t BLOCK = 64*1024;
+  std::vector<std::vector<uint8_t>> blocks; size_t cur=0, used=0;
+  StateArena() {}
+  StateArena(const StateArena&) = delete;
+  StateArena& operator=(const StateArena&) = delete;
+  ~StateArena(){ stateEpoch++; }
+  void* alloc(size_t n){
+    n = (n+15) & ~(size_t)15;
+    while(cur<blocks.size() && used+n>blocks[cur].size()){ cur++; used=0; }
+    if(cur==blocks.size()) blocks.push_back(std::vector<uint8_t>(std::max(n, BLOCK)));
+    void* p = blocks[cur].data()+used; used += n; return p;
+  }
+  void reset(){ cur=0; used=0; stateEpoch++; }   // blocks are kept for reuse
+  size_t bytes() const { size_t b=used; for(size_t k=0;k<cur;k++) b += blocks[k].size(); return b; }
+};
+
+template<class T, int P> struct CowArray {
+  const T* const* page=nullptr; int n=0;
+  int pages() const { return (n+P-1)/P; }
+  int len(int p) const { return std::min(P, n-p*P); }
+};
+
+struct FxPage { int head[FX_LEVELS*FX_SLOTS]; uint64_t mask[FX_LEVELS]; int nPool, nFree; const Effect* pool; const int* free; };
+
+struct GameState {
+  CowArray<Brick,STATE_BRICK_PAGE> bricks;
+  CowArray<Perk,STATE_ENTITY_PAGE> perks;
+  CowArray<Bullet,STATE_ENTITY_PAGE> bullets;
+  const FxPage* fx=nullptr; const std::mt19937* rng=nullptr;
+  Screen current=MENU; int bricksAlive=0, lives=0, score=0;
+  float playTime=0.f, globalSpeedGain=0.f, fxAccum=0.f, slowAccum=0.f; uint32_t fxNow=0;
+  bool leftHeld=false, rightHeld=false, hasLaunched=false, canResume=false;
+  Ball ball; Paddle paddle;
+};
+
+static thread_local GameState forkSync;   // what the live game was last captured to or restored from
+static thread_local uint32_t forkSyncFx=0, forkSyncEpoch=0;
+static thread_local long long statePagesCopied=0;
+
+static bool forkValid(){ return forkSynced && forkSyncEpoch==stateEpoch.load(std::memory_order_relaxed); }
+static bool brickPageTouched(int p){ return (size_t)p/64 < brickTouched.size() && (brickTouched[p/64]>>(p%64) & 1); }
+
+template<class T, int P> static bool cowPageEqual(const std::vector<T>& live, const CowArray<T,P>& a, int p){
+  return std::memcmp(live.data()+(size_t)p*P, a.page[p], a.len(p)*sizeof(T))==0;
+}
+
+// Pages for which same(p) holds are shared with prev; the page table itself
+// is shared when every page is.
+template<class T, int P, class Same>
+static void cowCapture(StateArena& A, const std::vector<T>& live, const CowArray<T,P>& prev, bool valid, Same same, CowArray<T,P>& out){
+  out.n = (int)live.size();
+  const T** table = nullptr; int np = out.pages();
+  for(int p=0;p<np;p++){
+    bool keep = valid && p<prev.pages() && prev.len(p)==out.len(p) && same(p);
+    if(keep && !table) continue;
+    if(!table){ table = (const T**)A.alloc(np*sizeof(T*)); std::copy(prev.page, prev.page+p, table); }
+    if(keep){ table[p] = prev.page[p]; continue; }
+    T* pg = (T*)A.alloc(P*sizeof(T));
+    std::memcpy((void*)pg, live.data()+(size_t)p*P, out.len(p)*sizeof(T));
+    table[p] = pg; ++statePagesCopied;
+  }
+  out.page = table ? table : np ? prev.page : nullptr;
+}
+
+template<class T, int P> static void cowLoad(const CowArray<T,P>& s, std::vector<T>& live){
+  live.resize(s.n);
+  for(int p=0;p<s.pages();p++) std::memcpy((void*)(live.data()+(size_t)p*P), s.page[p], s.len(p)*sizeof(T));
+}
+
+static void captureState(StateArena& A, GameState& out){
+  bool valid = forkValid();
+  const GameState& prev = forkSync;
+  cowCapture(A, bricks, prev.bricks, valid, [](int p){ return !brickPageTouched(p); }, out.bricks);
+  cowCapture(A, perks, prev.perks, valid, [&](int p){ return cowPageEqual(perks, prev.perks, p); }, out.perks);
+  cowCapture(A, bullets, prev.bullets, valid, [&](int p){ return cowPageEqual(bullets, prev.bullets, p); }, out.bullets);
+
+  if(valid && fxVersion==forkSyncFx) out.fx = prev.fx;
+  else {
+    FxPage* f = (FxPage*)A.alloc(sizeof(FxPage));
+    std::copy(fxHead, fxHead+FX_LEVELS*FX_SLOTS, f->head); std::copy(fxMask, fxMask+FX_LEVELS, f->mask);
+    f->nPool = (int)fxPool.size(); f->nFree = (int)fxFree.size();
+    Effect* pool = (Effect*)A.alloc(fxPool.size()*sizeof(Effect)); std::copy(fxPool.begin(), fxPool.end(), pool);
+    int* fr = (int*)A.alloc(fxFree.size()*sizeof(int)); std::copy(fxFree.begin(), fxFree.end(), fr);
+    f->pool = pool; f->free = fr; out.fx = f;
+  }
+  out.rng = valid && rng==*prev.rng ? prev.rng : new (A.alloc(sizeof(std::mt19937))) std::mt19937(rng);
+
+  out.current=current; out.bricksAlive=bricksAlive; out.lives=lives; out.score=score;
+  out.playTime=playTime; out.globalSpeedGain=globalSpeedGain; out.fxAccum=fxAccum; out.fxNow=fxNow; out.slowAccum=slowAccum;
+  out.leftHeld=leftHeld; out.rightHeld=rightHeld; out.hasLaunched=hasLaunched; out.canResume=canResume;
+  out.ball=ball; out.paddle=paddle;
+
+  forkSync = out; forkSyncFx = fxVersion; forkSyncEpoch = stateEpoch.load(std::memory_order_relaxed); forkSynced = true;
+  std::fill(brickTouched.begin(), brickTouched.end(), 0ull);
+}
+
+static void restoreBricks(const CowArray<Brick,STATE_BRICK_PAGE>& s, bool valid){
+  if(!valid || (int)bricks.size()!=s.n || gridCells.empty()){
+    cowLoad(s, bricks); gridBuild(); brickLayerStale=true;
+    tickBricks.clear();
+    for(size_t i=0;i<bricks.size();++i) if(brickTypes[bricks[i].type].on[EV_TICK].entry>=0) tickBricks.push_back((int)i);
+    return;
+  }
+  for(int p=0;p<s.pages();p++){
+    if(s.page[p]==forkSync.bricks.page[p] && !brickPageTouched(p)) continue;
+    const Brick* src = s.page[p]; int base = p*STATE_BRICK_PAGE;
+    for(int k=0;k<s.len(p);k++){
+      Brick& b = bricks[base+k]; const Brick& n = src[k];
+      bool moved = b.x!=n.x || b.y!=n.y, add = n.alive && (!b.alive || moved);
+      if(b.alive && (!n.alive || moved)) gridRemove(base+k);
+      b = n;
+      if(add) gridInsert(base+k);
+    }
+    brickLayerStale = true;
+  }
+}
+
+static void restoreState(const GameState& s){
+  bool valid = forkValid();
+  restoreBricks(s.bricks, valid);
+  cowLoad(s.perks, perks); cowLoad(s.bullets, bullets);
+
+  if(!(valid && s.fx==forkSync.fx && fxVersion==forkSyncFx)){
+    const FxPage& f = *s.fx;
+    fxPool.assign(f.pool, f.pool+f.nPool); fxFree.assign(f.free, f.free+f.nFree);
+    std::copy(f.head, f.head+FX_LEVELS*FX_SLOTS, fxHead); std::copy(f.mask, f.mask+FX_LEVELS, fxMask);
+    fxIndex.clear();
+    for(int i=0;i<f.nPool;i++) if(f.pool[i].slot>=0) fxIndex[fxKey(f.pool[i].kind, f.pool[i].target)] = i;
+    ++fxVersion;
+  }
+  if(!(valid && s.rng==forkSync.rng && rng==*s.rng)) rng = *s.rng;
+
+  current=s.current; bricksAlive=s.bricksAlive; lives=s.lives; score=s.score;
+  playTime=s.playTime; globalSpeedGain=s.globalSpeedGain; fxAccum=s.fxAccum; fxNow=s.fxNow; slowAccum=s.slowAccum;
+  leftHeld=s.leftHeld; rightHeld=s.rightHeld; hasLaunched=s.hasLaunched; canResume=s.canResume;
+  ball=s.ball; paddle=s.paddle;
+
+  forkSync = s; forkSyncFx = fxVersion; forkSyncEpoch = stateEpoch.load(std::memory_order_relaxed); forkSynced = true;
+  std::fill(brickTouched.begin(), brickTouched.end(), 0ull);
+}
+
+// --- Invariant Checker ---
+// --check N: every N ticks the game thread copies the game into a free
+// CheckSlot, using a full captureState() into the slot's own arena plus the
+// broadphase flattened into two arrays. That copy is all the game thread
+// pays. If every slot is still waiting, the snapshot is skipped, never
+// waited for. A background thread checks the slots in capture order:
+// - the ball inside the playfield and not inside a live brick (unless it
+//   passes through bricks);
+// - lives within [0, MAX_LIVES];
+// - score never falling within a game;
+// - bricksAlive matching the brick table;
+// - the effect wheel's lists, free list and level masks agreeing with its
+//   pool;
+// - the broadphase holding exactly the live bricks over their cells, in
+//   ascending order.
+// Violations go to stderr. For the first bad snapshot of a game, the game
+// thread writes a replay excerpt: the game's recording cut at that tick
+// (DXR1, so --bench and --verify can replay it), written to --record DIR or
+// the working directory, with the last inputs before it printed. The
+// previous game's recording is kept, so a game that ended before the
+// checker caught up still gets its excerpt.
+static const int CHECK_SLOTS = 4, CHECK_REPORTS = 8;   // violation lines printed per game
+enum { CHECK_FREE, CHECK_FULL };
+
+struct CheckSlot {
+  StateArena arena; GameState s;
+  std::vector<int> cellStart, cellItems; int cols=0, rows=0;   // broadphase: cell c holds items [cellStart[c], cellStart[c+1])
+  uint64_t seq=0, game=0; uint32_t tick=0;                   // tick: recorded ticks so far
+  std::atomic<int> stage{CHECK_FREE};
+};
+struct CheckRequest { uint64_t game; uint32_t tick; };
+
+static CheckSlot         checkSlots[CHECK_SLOTS];
+static std::atomic<bool> checkRunning{false};
+static std::thread       checkThread;
+static std::mutex        checkMx;          // guards checkRequests
+static std::vector<CheckRequest> checkRequests;
+static uint64_t          checkSeq=0, checkSkipped=0;
+static std::atomic<long long> checkDone{0}, checkViolations{0};
+static int               checkSinceLast=0, checkExcerpts=0;
+
+// Appends a description of every broken invariant to out.
+static void checkSnapshot(const CheckSlot& c,int& lastScore,uint64_t& lastGame,std::vector<std::string>& out){
+  const GameState& g = c.s; char buf[160];
+  auto fail = [&](const char* fmt,double a,double b){ std::snprintf(buf, sizeof(buf), fmt, a, b); out.push_back(buf); };
+  const Ball& b = g.ball; const float eps = 0.01f;
+
+  if(g.current==PLAY && !b.stuck){
+    if(b.pos.x < b.radius-eps || b.pos.x > scrW-b.radius+eps || b.pos.y < b.radius-eps || b.pos.y > scrH-b.radius+eps)
+      fail("ball out of bounds at (%.2f, %.2f)", b.pos.x, b.pos.y);
+  }
+  int alive = 0;
+  for(int p=0;p<g.bricks.pages();p++)
+    for(int k=0;k<g.bricks.len(p);k++){
+      const Brick& k2 = g.bricks.page[p][k]; if(!k2.alive) continue;
+      ++alive;
+      if(g.current==PLAY && !b.through && !b.fireball && std::fabs(b.pos.x-k2.x) < k2.w/2.f && std::fabs(b.pos.y-k2.y) < k2.h/2.f)
+        fail("ball centre inside live brick %.0f (hp %.0f)", p*STATE_BRICK_PAGE+k, k2.hp);
+    }
+  if(alive != g.bricksAlive) fail("bricksAlive %.0f but %.0f live bricks", g.bricksAlive, alive);
+  if(g.lives < 0 || g.lives > MAX_LIVES) fail("lives %.0f outside [0, %.0f]", g.lives, MAX_LIVES);
+  if(c.game==lastGame && g.score < lastScore) fail("score fell from %.0f to %.0f", lastScore, g.score);
+  lastGame = c.game; lastScore = g.score;
+
+  // Effect wheel: walk every slot list, then account for every pool entry.
+  const FxPage& f = *g.fx;
+  std::vector<char> seen(f.nPool, 0); int linked = 0;
+  for(int s=0;s<FX_LEVELS*FX_SLOTS;s++){
+    bool bit = (f.mask[s/FX_SLOTS]>>(s & (FX_SLOTS-1)) & 1) != 0;
+    if(bit != (f.head[s]>=0)) fail("wheel slot %.0f mask bit %.0f disagrees with its list", s, bit);
+    for(int i=f.head[s], prev=-1; i>=0; prev=i, i=f.pool[i].next){
+      if(i>=f.nPool || seen[i]){ fail("wheel slot %.0f list broken at entry %.0f", s, i); break; }
+      seen[i] = 1; ++linked;
+      const Effect& e = f.pool[i];
+      if(e.slot!=s || e.prev!=prev) fail("effect %.0f filed in slot %.0f with wrong slot or back link", i, s);
+    }
+  }
+  for(int k=0;k<f.nFree;k++){
+    int i = f.free[k];
+    if(i<0 || i>=f.nPool || seen[i]) fail("free list entry %.0f (index %.0f) invalid or in use", k, i);
+    else if(f.pool[i].slot>=0) fail("free effect %.0f still has slot %.0f", i, f.pool[i].slot);
+    else seen[i] = 2;
+  }
+  if(linked + f.nFree != f.nPool) fail("effect pool %.0f entries, %.0f linked or free", f.nPool, linked + f.nFree);
+
+  // Broadphase against the brick table, with the same cell mapping as gridBuild().
+  if(c.cols>0){
+    std::vector<std::vector<int>> want((size_t)c.cols*c.rows);
+    auto cx = [&](float x){ return clampv((int)std::floor(x/GRID_CELL), 0, c.cols-1); };
+    auto cy = [&](float y){ return clampv((int)std::floor(y/GRID_CELL), 0, c.rows-1); };
+    for(int p=0;p<g.bricks.pages();p++)
+      for(int k=0;k<g.bricks.len(p);k++){
+        const Brick& k2 = g.bricks.page[p][k]; if(!k2.alive) continue;
+        for(int y=cy(k2.y-k2.h/2.f); y<=cy(k2.y+k2.h/2.f); y++)
+          for(int x=cx(k2.x-k2.w/2.f); x<=cx(k2.x+k2.w/2.f); x++) want[(size_t)y*c.cols+x].push_back(p*STATE_BRICK_PAGE+k);
+      }
+    for(size_t cell=0; cell<want.size(); cell++){
+      const int* got = c.cellItems.data() + c.cellStart[cell]; int n = c.cellStart[cell+1]-c.cellStart[cell];
+      if(n!=(int)want[cell].size() || !std::equal(want[cell].begin(), want[cell].end(), got)){
+        fail("broadphase cell %.0f holds %.0f bricks, table says otherwise", cell, n); break;
+      }
+    }
+  }
+}
+
+static void checkLoop(){
+  int lastScore = 0, printed = 0; uint64_t lastGame = ~0ull, next = 1, reported = ~0ull; std::vector<std::string> bad;
+  for(;;){
+    bool running = checkRunning.load(std::memory_order_acquire);
+    CheckSlot* c = nullptr;
+    for(CheckSlot& s : checkSlots) if(s.stage.load(std::memory_order_acquire)==CHECK_FULL && (!c || s.seq < c->seq)) c = &s;
+    if(!c){
+      if(!running) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1)); continue;
+    }
+    if(c->seq != next) lastGame = ~0ull;   // skipped snapshots: the score history has a gap
+    next = c->seq+1;
+    bad.clear(); checkSnapshot(*c, lastScore, lastGame, bad);
+    if(!bad.empty()){
+      if(c->game != reported){ reported = c->game; printed = 0; std::lock_guard<std::mutex> g(checkMx); checkRequests.push_back({c->game, c->tick}); }
+      for(const std::string& m : bad)
+        if(printed++ < CHECK_REPORTS) std::fprintf(stderr, "check: game %llu tick %u (t=%.3fs): %s\n", (unsigned long long)c->game, c->tick, c->s.playTime, m.c_str());
+      checkViolations += (long long)bad.size();
+    }
+    ++checkDone;
+    c->stage.store(CHECK_FREE, std::memory_order_release);
+  }
+}
+
+static void checkExcerpt(const CheckRequest& q){
+  const Replay* r = q.game==checkGame ? &recording : q.game==checkGame-1 ? &checkPrev : nullptr;
+  if(!r){ std::fprintf(stderr, "check: game %llu: recording already gone, no excerpt\n", (unsigned long long)q.game); return; }
+  Replay x; x.seed = r->seed; x.rate = r->rate;
+  x.dts.assign(r->dts.begin(), r->dts.begin() + std::min<size_t>(q.tick, r->dts.size()));
+  for(const InputEvent& e : r->events) if(e.tick < q.tick) x.events.push_back(e);
+  char name[64]; std::snprintf(name, sizeof(name), "check_%u_t%u.dxr", x.seed, q.tick);
+  std::string path = (recordDir.empty() ? std::string(".") : recordDir) + "/" + name;
+  bool ok = saveReplay(path, x); ++checkExcerpts;
+  std::fprintf(stderr, "check: excerpt %s %s (%u ticks, %d inputs%s)\n", path.c_str(), ok ? "written" : "NOT written",
+               q.tick, (int)x.events.size(), levelIndex>=0 ? "; replays assume the built-in layout" : "");
+  static const char* kinds[] = {"left", "right", "paddle-x", "launch-key", "launch-mouse", "fire"};
+  for(size_t k = x.events.size() > 8 ? x.events.size()-8 : 0; k<x.events.size(); k++)
+    std::fprintf(stderr, "  tick %u: %s %.2f\n", x.events[k].tick, kinds[x.events[k].kind % 6], x.events[k].value);
+}
+
+static void checkServeRequests(){
+  std::vector<CheckRequest> q;
+  { std::lock_guard<std::mutex> g(checkMx); q.swap(checkRequests); }
+  for(const CheckRequest& r : q) checkExcerpt(r);
+}
+
+static void checkTick(){
+  if(!checkRunning.load(std::memory_order_relaxed)) return;
+  if(++checkSinceLast >= checkEvery){
+    checkSinceLast = 0;
+    CheckSlot* c = nullptr;
+    for(CheckSlot& s : checkSlots) if(s.stage.load(std::memory_order_acquire)==CHECK_FREE){ c = &s; break; }
+    if(!c) ++checkSkipped;
+    else {
+      c->arena.reset(); forkSynced = false;   // full copy: the slot must not share pages with another slot's arena
+      captureState(c->arena, c->s);
+      c->cols = gridCells.empty() ? 0 : gridCols; c->rows = gridRows;
+      c->cellStart.resize(gridCells.size()+1); c->cellItems.clear();
+      for(size_t k=0;k<gridCells.size();k++){ c->cellStart[k] = (int)c->cellItems.size(); c->cellItems.insert(c->cellItems.end(), gridCells[k].begin(), gridCells[k].end()); }
+      c->cellStart[gridCells.size()] = (int)c->cellItems.size();
+      c->seq = ++checkSeq; c->game = checkGame; c->tick = (uint32_t)recording.dts.size();
+      c->stage.store(CHECK_FULL, std::memory_order_release);
+    }
+  }
+  if(checkViolations.load(std::memory_order_relaxed)) checkServeRequests();
+}
+
+static void checkFinish(){
+  if(!checkRunning.exchange(false)) return;
+  checkThread.join();
+  checkServeRequests();
+  std::fprintf(stderr, "check: %lld snapshots checked every %d ticks, %llu skipped (checker busy), %lld violations, %d excerpts\n",
+               checkDone.load(), checkEvery, (unsigned long long)checkSkipped, checkViolations.load(), checkExcerpts);
+}
+
+static void checkStart(int every){
+  checkEvery = std::max(1, every); checkRunning = true;
+  checkThread = std::thread(checkLoop);
+  std::atexit(checkFinish);
+}
+
+// --- Level Solver ---
+// --solve W: beam search for a near-minimum clear time, used as the level's
+// par. Every SOLVE_STEP ticks each beam state is forked once per action and
+// played forward under that action's policy. While the ball is stuck, the
+// paddle walks to one of SOLVE_ACTIONS launch points and launches. While the
+// ball falls, the paddle meets it at one of SOLVE_ACTIONS offsets along its
+// width, which picks the bounce angle through `rel` in updateGame(). A rising
+// ball gets only the centre action, because no policy moves the paddle then.
+//
+// Children are ranked by remaining brick hp, then lives. A state whose hash
+// was already kept at this or an earlier depth is pruned, since reaching it
+// later is never faster. The best W survive. Every state at a depth has the
+// same play time, so the first depth with a win gives the par. Expansion
+// runs on the job system with one parent per job. Survivors are copied into
+// a fresh arena each depth, so the dead branches are freed by a reset. The
+// winning line is then replayed with recording on: the par must reproduce,
+// and --record writes the replay. Perk drops follow the rng, so a par holds
+// for one seed only: --solve uses SOLVE_SEED unless --seed is given, and the
+// seed is printed with every par.
+static const unsigned SOLVE_SEED = 1;
+static const int SOLVE_STEP = 15, SOLVE_ACTIONS = 7;
+static const float solveOffset[SOLVE_ACTIONS] = {-0.85f, -0.55f, -0.25f, 0.f, 0.25f, 0.55f, 0.85f};
+
+struct SolveNode { GameState s; uint64_t hash=0; float value=0.f; int hp=0, parent=-1, action=0; };
+
+// One tick of action a's policy; in is applyInput in branches, playerInput
+// when the line is replayed for the record.
+static void solvePolicy(int a, void (*in)(int,float)){
+  float target = paddle.pos.x;
+  if(ball.stuck) target = scrW*(a+1.f)/(SOLVE_ACTIONS+1);
+  else if(ball.vel.y < 0.f) target = predictTarget() - solveOffset[a]*paddle.w/2.f;
+  target = clampv(target, paddle.w/2.f+6.f, scrW - paddle.w/2.f - 6.f);
+  bool wantL = target < paddle.pos.x - 4.f, wantR = !wantL && target > paddle.pos.x + 4.f;
+  if(wantL != leftHeld)  in(IN_LEFT,  wantL ? 1.f : 0.f);
+  if(wantR != rightHeld) in(IN_RIGHT, wantR ? 1.f : 0.f);
+  if(ball.stuck && !wantL && !wantR) in(IN_LAUNCH_KEY, 0.f);
+}
+
+// Transposition hash (positions quantised, play time left out) and rank.
+static void solveMeasure(SolveNode& c){
+  uint64_t h = 0x243f6a8885a308d3ull;
+  auto mix = [&h](int64_t v){ h = (h ^ (uint64_t)v) * 0x9e3779b97f4a7c15ull; h ^= h >> 29; };
+  mix(std::lround(ball.pos.x*4.f)); mix(std::lround(ball.pos.y*4.f)); mix(std::lround(ball.vel.x)); mix(std::lround(ball.vel.y));
+  mix(std::lround(ball.speed)); mix(std::lround(paddle.pos.x*4.f)); mix(std::lround(paddle.w));
+  mix(lives | ball.stuck<<4 | ball.through<<5 | ball.fireball<<6 | paddle.shooting<<7 | leftHeld<<8 | rightHeld<<9 | (int)current<<10);
+  int hp = 0;
+  for(size_t i=0;i<bricks.size();++i) if(bricks[i].alive){ hp += bricks[i].hp; mix((int64_t)i<<8 | (bricks[i].hp & 255)); }
+  for(const Perk& p : perks) if(p.alive){ mix(p.type); mix(std::lround(p.pos.x)); mix(std::lround(p.pos.y)); }
+  for(const Bullet& b : bullets) if(b.alive){ mix(std::lround(b.pos.x)); mix(std::lround(b.pos.y)); }
+  c.hash = h; c.hp = hp; c.value = -100.f*hp + 150.f*lives - (ball.stuck ? 50.f : 0.f);
+}
+
+static bool solveLevel(int beamW, uint32_t seed, const std::string& name){
+  typedef std::chrono::steady_clock clk;
+  auto t0 = clk::now();
+  int W = std::max(1, jobWorkers);
+  std::unique_ptr<StateArena[]> childA(new StateArena[W]), beamA(new StateArena[2*W]);
+  newGameSeeded(seed); branchSim = true;
+  std::vector<SolveNode> beam(1), kids, next; captureState(beamA[0], beam[0].s);
+  std::vector<std::vector<std::pair<int,int>>> line;   // per depth: (parent, action) of each survivor
+  std::unordered_set<uint64_t> seen;
+  std::atomic<long long> ticks(0); long long states=0, pruned=0;
+  int winner = -1, depth = 0;
+  for(; !beam.empty() && beam[0].s.playTime < HEADLESS_MAX_TIME; depth++){
+    kids.assign(beam.size()*SOLVE_ACTIONS, SolveNode());
+    parallelFor((int)beam.size(), 1, [&](int b,int e){
+      ++jobSerial; bool was = branchSim; branchSim = true; int w = std::max(jobIndex, 0); long long n = 0;
+      for(int i=b;i<e;i++){
+        restoreState(beam[i].s);
+        int acts = !ball.stuck && ball.vel.y >= 0.f ? 1 : SOLVE_ACTIONS;
+        for(int k=0;k<acts;k++){
+          int a = acts==1 ? SOLVE_ACTIONS/2 : k;
+          if(k) restoreState(beam[i].s);
+          for(int t=0;t<SOLVE_STEP && current==PLAY;t++){ solvePolicy(a, applyInput); updateGame(HEADLESS_DT); playTime += HEADLESS_DT; ++n; }
+          if(current==GAMEOVER) continue;
+          SolveNode& c = kids[(size_t)i*SOLVE_ACTIONS+a];
+          c.parent = i; c.action = a; solveMeasure(c); captureState(childA[w], c.s);
+        }
+      }
+      ticks += n; branchSim = was; --jobSerial;
+    });
+
+    std::vector<int> order;
+    for(size_t k=0;k<kids.size();++k) if(kids[k].parent>=0) order.push_back((int)k);
+    states += (long long)order.size();
+    for(int k : order) if(kids[k].s.current==WIN && (winner<0 || kids[k].s.playTime < kids[winner].s.playTime)) winner = k;
+    if(winner>=0) break;
+    std::sort(order.begin(), order.end(), [&](int x,int y){
+      return kids[x].value!=kids[y].value ? kids[x].value > kids[y].value : kids[x].hash!=kids[y].hash ? kids[x].hash < kids[y].hash : x < y; });
+    std::vector<int> keep;
+    for(int k : order){
+      if((int)keep.size() >= beamW) break;
+      if(seen.insert(kids[k].hash).second) keep.push_back(k); else ++pruned;
+    }
+
+    int gen = (depth+1)%2;
+    for(int w=0;w<W;w++) beamA[gen*W+w].reset();
+    next.assign(keep.size(), SolveNode());
+    parallelFor((int)keep.size(), 4, [&](int b,int e){
+      ++jobSerial; bool was = branchSim; branchSim = true; int w = std::max(jobIndex, 0);
+      for(int i=b;i<e;i++){
+        next[i] = kids[keep[i]];
+        restoreState(next[i].s); forkSynced = false;   // full copy: nothing may point into the child arenas
+        captureState(beamA[gen*W+w], next[i].s);
+      }
+      branchSim = was; --jobSerial;
+    });
+    for(int w=0;w<W;w++) childA[w].reset();
+    line.push_back(std::vector<std::pair<int,int>>());
+    for(int k : keep) line.back().push_back(std::make_pair(kids[k].parent, kids[k].action));
+    beam.swap(next);
+    if(depth%80==79 && !beam.empty()) std::printf("  %s: t=%.1fs beam=%d best hp left=%d\n", name.c_str(), beam[0].s.playTime, (int)beam.size(), beam[0].hp);
+  }
+  branchSim = false;
+  double wall = std::chrono::duration<double>(clk::now()-t0).count();
+  long long nt = ticks.load();
+  if(winner<0){
+    std::printf("level %s: no clear found (beam %d, %d depths, %lld states, %lld ticks in %.2fs)\n", name.c_str(), beamW, depth, states, nt, wall);
+    return false;
+  }
+
+  std::vector<int> acts(depth+1); acts[depth] = kids[winner].action;
+  for(int d=depth-1, j=kids[winner].parent; d>=0; d--){ acts[d] = line[d][j].second; j = line[d][j].first; }
+  float par = kids[winner].s.playTime; int parScore = kids[winner].s.score, parLives = kids[winner].s.lives;
+  newGameSeeded(seed);
+  for(int d=0; d<=depth && current==PLAY; d++)
+    for(int t=0;t<SOLVE_STEP && current==PLAY;t++){ solvePolicy(acts[d], playerInput); recordTick(HEADLESS_DT); updateGame(HEADLESS_DT); playTime += HEADLESS_DT; }
+  bool ok = current==WIN && playTime==par && score==parScore;
+  std::printf("level %s: par %.3fs (seed %u) score=%d lives=%d | beam %d, %d depths, %lld states, %lld pruned | %lld ticks in %.2fs = %.0f ticks/s on %d workers | replay %s\n",
+              name.c_str(), par, seed, parScore, parLives, beamW, depth+1, states, pruned, nt, wall, wall>0 ? nt/wall : 0.0, W, ok ? "verified" : "MISMATCH");
+  return ok;
+}
+
+static int runSolve(int beamW, unsigned seed){
+  headless = true;
+  int levels = levelPack.empty() ? 1 : (int)levelPack.size(), failed = 0;
+  for(int L=0; L<levels; L++){
+    if(!levelPack.empty()) levelIndex = L;
+    if(!solveLevel(std::max(1, beamW), seed, levelPack.empty() ? std::string("built-in") : levelPack[L].name)) ++failed;
+  }
+  perfPrintSummary(stdout);
+  return failed ? 1 : 0;
+}
+
+// --- Arena ---
+// --arena N tiles N (up to ARENA_MAX) autopilot games in one window. Each
+// game lives as a GameState (see State Forking); every frame the games are
+// restored, stepped and captured again on the job system, one game per job,
+// and the tiles are drawn straight from the snapshots: each brick, paddle,
+// ball, perk and bullet of every tile is one quad in quadBatch, which the
+// backend submits in a single draw call, plus one line of header text.
+// Captures are full copies into arenas double-buffered by frame, so the
+// previous frame's arenas are reset wholesale. Game i plays solvePolicy
+// action i % SOLVE_ACTIONS, so neighbouring tiles aim differently. Games
+// advance in HEADLESS_DT ticks whatever the frame rate and are not recorded;
+// a finished game stays up for ARENA_HOLD frames, then restarts with the
+// next seed. --arena N --headless F runs F frames of 1/60 s on the null (or
+// --soft) backend and reports frame times against the 60 fps budget.
+static const int ARENA_MAX = 64, ARENA_HOLD = 90, ARENA_HEADER = 22;
+
+struct Arena {
+  int n=0, W=1, gen=0, cols=1, rows=1, winW=0, winH=0;
+  uint32_t nextSeed=0; long long ticks=0, wins=0, losses=0;
+  float accum=0.f; double simMs=0, buildMs=0, fps=0;
+  std::vector<GameState> games; std::vector<int> hold;
+  std::unique_ptr<StateArena[]> arenas;   // [2][W]
+  std::vector<std::vector<QuadVertex>> tileQuads;
+};
+static Arena arena;
+
+static double arenaMs(std::chrono::steady_clock::time_point t0){
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t0).count();
+}
+
+static void arenaRestart(int i){
+  Arena& A = arena;
+  newGameSeeded(A.nextSeed++); forkSynced = false;
+  captureState(A.arenas[A.gen*A.W], A.games[i]); A.hold[i] = 0;
+}
+
+static void arenaInit(int n,uint32_t seed,int winW,int winH){
+  Arena& A = arena;
+  A.n = clampv(n, 1, ARENA_MAX); A.W = std::max(1, jobWorkers); A.nextSeed = seed;
+  A.games.assign(A.n, GameState()); A.hold.assign(A.n, 0); A.tileQuads.assign(A.n, std::vector<QuadVertex>());
+  A.arenas.reset(new StateArena[2*A.W]);
+  brickCache = false;   // tiles never use the live game's brick layer
+  for(int i=0;i<A.n;i++) arenaRestart(i);
+  A.winW = winW; A.winH = winH;
+}
+
+// Grid with the largest tile scale for the window.
+static void arenaLayout(){
+  Arena& A = arena; float best = -1.f;
+  for(int c=1;c<=A.n;c++){
+    int r = (A.n+c-1)/c;
+    float s = std::min((float)A.winW/c/scrW, (float)(A.winH-ARENA_HEADER)/r/scrH);
+    if(s > best){ best = s; A.cols = c; A.rows = r; }
+  }
+}
+
+static void arenaStep(int ticks){
+  Arena& A = arena;
+  auto t0 = std::chrono::steady_clock::now();
+  A.gen ^= 1;
+  for(int w=0;w<A.W;w++) A.arenas[A.gen*A.W+w].reset();
+  for(int i=0;i<A.n;i++) if(A.hold[i] > ARENA_HOLD) arenaRestart(i);
+  std::atomic<long long> ticked(0);
+  parallelFor(A.n, 1, [&](int b,int e){
+    ++jobSerial; bool was = branchSim; branchSim = true; int w = std::max(jobIndex, 0); long long nt = 0;
+    for(int i=b;i<e;i++){
+      restoreState(A.games[i]);
+      for(int t=0;t<ticks && current==PLAY;t++){ solvePolicy(i%SOLVE_ACTIONS, applyInput); updateGame(HEADLESS_DT); playTime += HEADLESS_DT; ++nt; }
+      if(current==PLAY && playTime>=HEADLESS_MAX_TIME) current = GAMEOVER;
+      forkSynced = false; captureState(A.arenas[A.gen*A.W+w], A.games[i]);
+    }
+    ticked += nt; branchSim = was; --jobSerial;
+  });
+  for(int i=0;i<A.n;i++)
+    if(A.games[i].current!=PLAY && A.hold[i]++==0) ++(A.games[i].current==WIN ? A.wins : A.losses);
+  A.ticks += ticked.load(); A.simMs = arenaMs(t0);
+}
+
+// Quads for tile i, in window pixels. Objects keep at least a pixel so the
+// ball and bullets stay visible on small tiles.
+static void arenaTile(int i,std::vector<QuadVertex>& q){
+  const Arena& A = arena; const GameState& g = A.games[i];
+  float tw = (float)A.winW/A.cols, th = (float)(A.winH-ARENA_HEADER)/A.rows;
+  float tx = (i%A.cols)*tw, ty = (A.winH-ARENA_HEADER) - (i/A.cols+1)*th;
+  float s = std::min((tw-2.f)/scrW, (th-2.f)/scrH);
+  float ox = tx + (tw-scrW*s)/2.f, oy = ty + (th-scrH*s)/2.f;
+  q.clear();
+  auto quad = [&q](float x0,float y0,float x1,float y1,uint32_t c){
+    QuadVertex v[4] = {{x0,y0,c}, {x1,y0,c}, {x1,y1,c}, {x0,y1,c}}; q.insert(q.end(), v, v+4);
+  };
+  auto world = [&](float cx,float cy,float w,float h,float gap,uint32_t c){
+    float pw = std::max(1.f, w*s-gap), ph = std::max(1.f, h*s-gap), px = ox+cx*s, py = oy+cy*s;
+    quad(px-pw/2.f, py-ph/2.f, px+pw/2.f, py+ph/2.f, c);
+  };
+
+  uint32_t frame = g.current==PLAY ? packRGB(0.22f,0.22f,0.28f) : g.current==WIN ? packRGB(0.2f,0.8f,0.3f) : packRGB(0.8f,0.2f,0.2f);
+  quad(ox-1.f, oy-1.f, ox+scrW*s+1.f, oy+scrH*s+1.f, frame);
+  quad(ox, oy, ox+scrW*s, oy+scrH*s, packRGB(0.03f,0.03f,0.05f));
+  for(int p=0;p<g.bricks.pages();p++)
+    for(int k=0;k<g.bricks.len(p);k++){
+      const Brick& b = g.bricks.page[p][k]; if(!b.alive) continue;
+      float rgb[3]; brickColor(b, rgb); world(b.x, b.y, b.w, b.h, 1.f, packRGB(rgb[0],rgb[1],rgb[2]));
+    }
+  for(int p=0;p<g.perks.pages();p++)
+    for(int k=0;k<g.perks.len(p);k++){
+      const Perk& pk = g.perks.page[p][k]; if(!pk.alive) continue;
+      const PerkIcon& ic = perkIcons[pk.type];
+      world(pk.pos.x + pk.vel.x*g.slowAccum, pk.pos.y + pk.vel.y*g.slowAccum, pk.size, pk.size, 0.f, packRGB(ic.r,ic.g,ic.b));
+    }
+  for(int p=0;p<g.bullets.pages();p++)
+    for(int k=0;k<g.bullets.len(p);k++){
+      const Bullet& bu = g.bullets.page[p][k]; if(bu.alive) world(bu.pos.x, bu.pos.y, bu.w, bu.h, 0.f, packRGB(1.f,0.9f,0.2f));
+    }
+  world(g.paddle.pos.x, g.paddle.pos.y, g.paddle.w, g.paddle.h, 0.f, packRGB(0.2f,0.5f,0.9f));
+  const Ball& bl = g.ball;
+  world(bl.pos.x, bl.pos.y, 2.f*bl.radius, 2.f*bl.radius, 0.f,
+        bl.fireball ? packRGB(1.f,0.45f,0.15f) : bl.through ? packRGB(0.9f,0.2f,1.f) : packRGB(0.3f,1.f,0.3f));
+
+  // Lives along the top, bricks cleared as a bar along the bottom.
+  for(int l=0;l<g.lives;l++) quad(ox+2.f+4.f*l, oy+scrH*s-4.f, ox+5.f+4.f*l, oy+scrH*s-1.f, packRGB(1.f,0.3f,0.3f));
+  if(g.bricks.n > 0) quad(ox, oy, ox + scrW*s*(1.f - (float)g.bricksAlive/g.bricks.n), oy+2.f, packRGB(1.f,0.9f,0.2f));
+}
+
+static void arenaRender(){
+  Arena& A = arena;
+  auto t0 = std::chrono::steady_clock::now();
+  arenaLayout();
+  parallelFor(A.n, 4, [&](int b,int e){ for(int i=b;i<e;i++) arenaTile(i, A.tileQuads[i]); });
+  quadBatch.clear();
+  for(int i=0;i<A.n;i++) quadBatch.insert(quadBatch.end(), A.tileQuads[i].begin(), A.tileQuads[i].end());
+  A.buildMs = arenaMs(t0);
+
+  beginFrame(0.f,0.f,0.f);
+  drawQuadBatch();
+  char hdr[192];
+  std::snprintf(hdr, sizeof(hdr), "ARENA  %d games | %.0f fps | sim %.2f ms  build %.2f ms | %d quads | %lld ticks | %lld cleared  %lld lost",
+                A.n, A.fps, A.simMs, A.buildMs, (int)quadBatch.size()/4, A.ticks, A.wins, A.losses);
+  setColor(0.8f,0.85f,1.f); drawText(6.f, A.winH-16.f, hdr, GLUT_BITMAP_HELVETICA_12);
+  presentFrame();
+}
+
+static void onArenaDisplay(){ arenaRender(); }
+
+static void onArenaIdle(){
+  static auto prev = std::chrono::steady_clock::now();
+  auto t = std::chrono::steady_clock::now();
+  float dt = std::min(0.1f, std::chrono::duration<float>(t-prev).count()); prev = t;
+  if(dt > 0.f) arena.fps = 0.9*arena.fps + 0.1/dt;
+  arena.accum += dt;
+  int ticks = (int)(arena.accum/HEADLESS_DT); arena.accum -= ticks*HEADLESS_DT;
+  arenaStep(ticks);
+  glutPostRedisplay();
+}
+
+static void onArenaReshape(int w,int h){
+  arena.winW=w; arena.winH=h; glViewport(0,0,w,h);
+  glMatrixMode(GL_PROJECTION); glLoadIdentity();
+  gluOrtho2D(0, (GLdouble)w, 0, (GLdouble)h);
+  glMatrixMode(GL_MODELVIEW); glLoadIdentity();
+}
+
+static void onArenaKey(unsigned char key,int,int){ if(key==27 || key=='q' || key=='Q') std::exit(0); }
+
+// Headless: frames of 1/60 s, timed end to end including the backend.
+static int runArenaBench(int n,int frames,uint32_t seed,bool soft){
+  headless = true; backend = soft ? BACKEND_SOFT : BACKEND_NULL;
+  arenaInit(n, seed, scrW, scrH);
+  frames = std::max(1, frames);
+  std::vector<double> ms(frames); double sim=0, build=0;
+  for(int f=0;f<frames;f++){
+    auto t0 = std::chrono::steady_clock::now();
+    arenaStep(2); arenaRender();
+    ms[f] = arenaMs(t0); sim += arena.simMs; build += arena.buildMs;
+  }
+  std::vector<double> sorted = ms; std::sort(sorted.begin(), sorted.end());
+  double mean = std::accumulate(ms.begin(), ms.end(), 0.0)/frames;
+  int over = (int)std::count_if(ms.begin(), ms.end(), [](double v){ return v > 1000.0/60.0; });
+  std::printf("arena: %d games x %d frames on %s, %d workers | frame mean %.3f ms p99 %.3f ms max %.3f ms, %d over 16.7 ms | sim %.3f ms build %.3f ms\n",
+              arena.n, frames, soft ? "soft" : "null", arena.W, mean, sorted[(size_t)(frames-1)*99/100], sorted.back(), over, sim/frames, build/frames);
+  std::printf("arena: %d quads/frame | %lld ticks | %lld cleared %lld lost\n", (int)quadBatch.size()/4, arena.ticks, arena.wins, arena.losses);
+  return 0;
+}
+
+// --- Tournament ---
+// --tourney G pits paddle policies against each other on G seeded games per
+// level (every level of --pack, or the built-in one). A policy is an
+// AiPolicy: track the ball or head for predictTarget(), meet it at `aim`
+// (-1..1 along the paddle's half width), stop within `dead` pixels, and
+// launch from `launch` (fraction of the width). --policies FILE lists one per
+// line as "name aim dead launch predict"; without it a built-in grid of 32
+// is used.
+//
+// The game is single-player, so a policy's result on a seed does not depend
+// on its opponent: every (policy, seed) game is played once, as jobs on the
+// job system, and every match is scored from that table. A match game goes
+// to the policy that cleared the level, then to the faster clear, then to
+// the higher score; otherwise it is drawn. The default is a round robin;
+// --bracket plays a single-elimination bracket seeded in list order. Elo
+// ratings are the fixed point of the Elo expectation over all matches played
+// (anchored at a mean of 1500, with one drawn game against the mean as a
+// prior so an unbeaten policy stays finite), so they do not depend on match
+// order. Seed i is --seed + i * 0x9E3779B9; games are not recorded and the
+// printed table checksum is identical for any --jobs.
+struct AiPolicy { std::string name; float aim=0.f, dead=4.f, launch=0.5f; bool predict=true; };
+
+static void aiPolicyTick(const AiPolicy& P, void (*in)(int,float)){
+  float target = paddle.pos.x;
+  if(ball.stuck) target = scrW*P.launch;
+  else if(P.predict) target = ball.vel.y < 0.f ? predictTarget() - P.aim*paddle.w/2.f : paddle.pos.x;
+  else target = ball.pos.x - P.aim*paddle.w/2.f;
+  target = clampv(target, paddle.w/2.f+6.f, scrW - paddle.w/2.f - 6.f);
+  bool wantL = target < paddle.pos.x - P.dead, wantR = !wantL && target > paddle.pos.x + P.dead;
+  if(wantL != leftHeld)  in(IN_LEFT,  wantL ? 1.f : 0.f);
+  if(wantR != rightHeld) in(IN_RIGHT, wantR ? 1.f : 0.f);
+  if(ball.stuck && !wantL && !wantR) in(IN_LAUNCH_KEY, 0.f);
+}
+
+static std::vector<AiPolicy> defaultPolicies(){
+  static const float aims[] = {-0.6f, -0.3f, 0.f, 0.3f}, deads[] = {2.f, 6.f, 12.f, 24.f};
+  std::vector<AiPolicy> v;
+  for(int p=1;p>=0;p--) for(float a : aims) for(float d : deads){
+    AiPolicy P; P.aim=a; P.dead=d; P.predict=p!=0;
+    char nm[48]; std::snprintf(nm, sizeof(nm), "%s/a%+.1f/d%d", p ? "predict" : "track", a, (int)d); P.name=nm;
+    v.push_back(P);
+  }
+  return v;
+}
+
+static bool loadPolicies(const std::string& path, std::vector<AiPolicy>& out){
+  std::ifstream in(path);
+  if(!in){ std::fprintf(stderr, "policies: cannot read %s\n", path.c_str()); return false; }
+  out.clear(); std::string line; int ln=0;
+  while(std::getline(in, line)){
+    ++ln;
+    size_t lead = line.find_first_not_of(" \t\r");
+    if(lead==std::string::npos || line[lead]=='#') continue;
+    char nm[64]; AiPolicy P; int pred=1;
+    if(std::sscanf(line.c_str(), "%63s %f %f %f %d", nm, &P.aim, &P.dead, &P.launch, &pred) < 1){
+      std::fprintf(stderr, "policies: %s:%d: expected name aim dead launch predict\n", path.c_str(), ln); return false;
+    }
+    P.name=nm; P.predict=pred!=0; P.launch=clampv(P.launch, 0.f, 1.f); P.dead=std::max(0.5f, P.dead);
+    out.push_back(P);
+  }
+  if(out.size()<2){ std::fprintf(stderr, "policies: %s: need at least two\n", path.c_str()); return false; }
+  return true;
+}
+
+struct TourneyGame { int score=0, lives=0; float time=0.f; bool won=false; };
+struct TourneyMatch { int a, b, wins=0, draws=0, losses=0; };   // from a's side
+
+// +1 if x beats y, -1 if y beats x, 0 for a draw.
+static int tourneyCompare(const TourneyGame& x,const TourneyGame& y){
+  if(x.won != y.won) return x.won ? 1 : -1;
+  if(x.won && std::fabs(x.time-y.time) > HEADLESS_DT/2.f) return x.time < y.time ? 1 : -1;
+  if(x.score != y.score) return x.score > y.score ? 1 : -1;
+  return 0;
+}
+
+static TourneyMatch tourneyMatch(const std::vector<TourneyGame>& res,int games,int a,int b){
+  TourneyMatch m; m.a=a; m.b=b;
+  for(int s=0;s<games;s++){
+    int c = tourneyCompare(res[(size_t)a*games+s], res[(size_t)b*games+s]);
+    if(c>0) ++m.wins; else if(c<0) ++m.losses; else ++m.draws;
+  }
+  return m;
+}
+
+static std::vector<double> eloFit(int P,const std::vector<TourneyMatch>& matches){
+  std::vector<double> r(P, 0.0), grad(P);
+  auto expect = [](double x,double y){ return 1.0/(1.0 + std::pow(10.0, (y-x)/400.0)); };
+  for(int it=0; it<20000; it++){
+    std::fill(grad.begin(), grad.end(), 0.0); double n = 1.0;
+    for(int i=0;i<P;i++) grad[i] = 0.5 - expect(r[i], 0.0);
+    for(const TourneyMatch& m : matches){
+      double g = m.wins+m.draws+m.losses, e = expect(r[m.a], r[m.b]), d = (m.wins + 0.5*m.draws) - g*e;
+      grad[m.a] += d; grad[m.b] -= d; n = std::max(n, g);
+    }
+    double step = 16.0/n, moved = 0.0;
+    for(int i=0;i<P;i++){ r[i] += step*grad[i]; moved = std::max(moved, std::fabs(step*grad[i])); }
+    if(moved < 1e-4) break;
+  }
+  double mean = std::accumulate(r.begin(), r.end(), 0.0)/P;
+  for(double& x : r) x += 1500.0 - mean;
+  return r;
+}
+
+static int runTourney(int games,unsigned seed,const std::string& policyFile,bool bracket){
+  headless = true;
+  std::vector<AiPolicy> pol = defaultPolicies();
+  if(!policyFile.empty() && !loadPolicies(policyFile, pol)) return 1;
+  int P = (int)pol.size(), levels = levelPack.empty() ? 1 : (int)levelPack.size();
+  games = std::max(1, games);
+  int G = games*levels;   // match games per pairing
+  std::vector<TourneyGame> res((size_t)P*G);
+  auto t0 = std::chrono::steady_clock::now();
+  std::atomic<long long> ticks(0);
+  for(int L=0; L<levels; L++){
+    if(!levelPack.empty()) levelIndex = L;
+    parallelFor(P*games, 4, [&](int b,int e){
+      ++jobSerial; bool was = branchSim; branchSim = true; long long n = 0;
+      for(int k=b;k<e;k++){
+        int p = k/games, s = k%games;
+        newGameSeeded(seed + 0x9E3779B9u*(uint32_t)s);
+        while(current==PLAY && playTime < HEADLESS_MAX_TIME){ aiPolicyTick(pol[p], applyInput); updateGame(HEADLESS_DT); playTime += HEADLESS_DT; ++n; }
+        TourneyGame& r = res[(size_t)p*G + (size_t)L*games + s];
+        r.won = current==WIN; r.score = score; r.lives = lives; r.time = playTime;
+      }
+      ticks += n; branchSim = was; --jobSerial;
+    });
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+
+  std::vector<TourneyMatch> matches;
+  std::vector<int> wins(P,0), draws(P,0), losses(P,0), out(P,0);   // out: bracket field size a policy went out in, 1 for the champion
+  if(!bracket){
+    for(int a=0;a<P;a++) for(int b=a+1;b<P;b++) matches.push_back(tourneyMatch(res, G, a, b));
+  } else {
+    int B = 1; while(B<P) B <<= 1;
+    std::vector<int> order(1, 0);   // standard seeding: seeds 1 and 2 can only meet in the final
+    while((int)order.size()<B){ std::vector<int> nx; int n2 = 2*(int)order.size(); for(int x : order){ nx.push_back(x); nx.push_back(n2-1-x); } order.swap(nx); }
+    std::vector<int> alive;
+    for(int x : order) alive.push_back(x<P ? x : -1);
+    while(alive.size()>1){
+      std::printf("round of %d:\n", (int)alive.size());
+      std::vector<int> nx;
+      for(size_t k=0;k<alive.size();k+=2){
+        int a = alive[k], b = alive[k+1];
+        if(a<0 || b<0){ nx.push_back(a<0 ? b : a); continue; }
+        TourneyMatch m = tourneyMatch(res, G, a, b); matches.push_back(m);
+        int w = m.wins!=m.losses ? (m.wins>m.losses ? a : b) : std::min(a, b);   // tie: higher seed goes through
+        out[w==a ? b : a] = (int)alive.size(); nx.push_back(w);
+        std::printf("  %-20s %4d-%d-%-4d %s\n", (pol[a].name+" v "+pol[b].name).c_str(), m.wins, m.draws, m.losses, pol[w].name.c_str());
+      }
+      alive.swap(nx);
+    }
+    if(alive[0]>=0){ out[alive[0]] = 1; std::printf("champion: %s\n", pol[alive[0]].name.c_str()); }
   }
+  for(const TourneyMatch& m : matches){
+    wins[m.a]+=m.wins; draws[m.a]+=m.draws; losses[m.a]+=m.losses;
+    wins[m.b]+=m.losses; draws[m.b]+=m.draws; losses[m.b]+=m.wins;
+  }
+  std::vector<double> elo = eloFit(P, matches);
+
+  std::vector<int> rank(P); std::iota(rank.begin(), rank.end(), 0);
+  std::stable_sort(rank.begin(), rank.end(), [&](int x,int y){ return elo[x] > elo[y]; });
+  std::printf(" #  policy               elo   cleared  median clear  mean score  match games W-D-L%s\n", bracket ? "  bracket" : "");
+  for(int k=0;k<P;k++){
+    int p = rank[k]; std::vector<float> clear; double sc = 0;
+    for(int s=0;s<G;s++){ const TourneyGame& r = res[(size_t)p*G+s]; sc += r.score; if(r.won) clear.push_back(r.time); }
+    std::sort(clear.begin(), clear.end());
+    char med[16] = "-"; if(!clear.empty()) std::snprintf(med, sizeof(med), "%.1fs", clear[clear.size()/2]);
+    char wdl[64]; int w = std::snprintf(wdl, sizeof(wdl), "%d-%d-%d", wins[p], draws[p], losses[p]);
+    int pad = std::max(2, 19-w);   // bracket column
+    if(bracket && out[p]==1) std::snprintf(wdl+w, sizeof(wdl)-w, "%*schampion", pad, "");
+    else if(bracket) std::snprintf(wdl+w, sizeof(wdl)-w, "%*sout in round of %d", pad, "", out[p]);
+    std::printf("%2d  %-18s %6.0f  %5.1f%%  %12s  %10.0f  %s\n", k+1, pol[p].name.c_str(), elo[p],
+                100.0*clear.size()/G, med, sc/G, wdl);
+  }
+  uint64_t h = 0xcbf29ce484222325ull;
+  for(const TourneyGame& r : res){ uint32_t t; std::memcpy(&t, &r.time, 4); for(uint32_t v : {(uint32_t)r.score, (uint32_t)r.won, t}){ h ^= v; h *= 0x100000001b3ull; } }
+  long long nt = ticks.load();
+  std::printf("tourney: %d policies x %d games (%d levels), %d matches, seed %u | checksum %016llx | %lld ticks in %.2fs = %.0f games/s on %d workers\n",
+              P, G, levels, (int)matches.size(), seed, (unsigned long long)h, nt, wall, wall>0 ? P*G/wall : 0.0, std::max(1, jobWorkers));
+  return 0;
+}
+
+// --- Tuner ---
+// --tune GROUP drives gameplay constants (game: perk chance, perk odds,
+// speed rates), the paddle policy (ai: aim, dead zone, launch point) or both
+// (all) toward a target median clear time and clear rate (--tune-target
+// SECONDS,RATE, default 180,0.3). The loss is the squared relative error of
+// each. Parameters are searched in a box normalised to [0,1] by a separable
+// CMA-ES: weighted recombination of the best half, cumulative step-size
+// control and a diagonal covariance. Perk odds are searched as eight weights
+// and turned into cuts.
+//
+// Every candidate of a generation plays the same --tune-games seeds (common
+// random numbers), so their differences are the parameters', not the luck of
+// the draw; the seeds move on each generation. Games run as jobs on the job
+// system, one (candidate, seed) per job, with the candidate's Tuning and
+// AiPolicy on that thread. After each generation the optimizer state,
+// including its rng, is written to --checkpoint FILE (via a rename, so a
+// crash never leaves half a file); starting again with the same file and
+// group resumes where it stopped. The best parameters are printed at the end.
+struct TuneParam { const char* name; bool ai; float lo, hi; };
+static const TuneParam tuneParams[] = {
+  {"perk_chance", false, 0.f, 0.6f},
+  {"w_extra_life", false, 0.f, 1.f}, {"w_speed_up", false, 0.f, 1.f}, {"w_wide", false, 0.f, 1.f}, {"w_shrink", false, 0.f, 1.f},
+  {"w_through", false, 0.f, 1.f}, {"w_fireball", false, 0.f, 1.f}, {"w_shooting", false, 0.f, 1.f}, {"w_death", false, 0.f, 1.f},
+  {"gain_rate", false, 0.f, 10.f}, {"speed_rate", false, 0.f, 12.f},
+  {"aim", true, -0.9f, 0.9f}, {"dead", true, 0.5f, 30.f}, {"launch", true, 0.05f, 0.95f},
+};
+static const int TUNE_PARAMS = (int)(sizeof(tuneParams)/sizeof(tuneParams[0]));
+
+static void tuneGet(const Tuning& T,const AiPolicy& P,float* v){
+  v[0] = T.perkChance;
+  for(int k=0;k<8;k++) v[1+k] = (k<7 ? T.perkCut[k] : 1.f) - (k ? T.perkCut[k-1] : 0.f);
+  v[9] = T.gainRate; v[10] = T.speedRate; v[11] = P.aim; v[12] = P.dead; v[13] = P.launch;
+}
+
+static void tuneSet(const float* v,Tuning& T,AiPolicy& P){
+  T.perkChance = v[0];
+  float total = 0.f; for(int k=0;k<8;k++) total += v[1+k];
+  float cum = 0.f;
+  for(int k=0;k<7;k++){ cum += total>0.f ? v[1+k]/total : 0.125f; T.perkCut[k] = cum; }
+  T.gainRate = v[9]; T.speedRate = v[10]; P.aim = v[11]; P.dead = v[12]; P.launch = v[13];
+}
+
+struct TuneState {
+  std::string group; int gen=0; double sigma=0.2, bestLoss=1e30;
+  uint32_t seed=0; int games=0, lambda=0;     // evaluation seeds and sizes: a resumed run keeps its own
+  std::vector<double> mean, C, pc, ps, best;   // normalised coordinates of the searched parameters
+  std::mt19937 rng;
+};
+
+static bool tuneSave(const std::string& path,const TuneState& S){
+  std::string tmp = path + ".tmp";
+  std::ofstream out(tmp);
+  if(!out) return false;
+  out << "dxtune 2\ngroup " << S.group << "\ngen " << S.gen << "\nseed " << S.seed << "\ngames " << S.games << "\npopulation " << S.lambda << "\n"
+      << std::setprecision(17) << "sigma " << S.sigma << "\nbest_loss " << S.bestLoss << "\n";
+  const std::vector<double>* rows[] = {&S.mean, &S.C, &S.pc, &S.ps, &S.best};
+  const char* names[] = {"mean", "C", "pc", "ps", "best"};
+  for(int r=0;r<5;r++){ out << names[r]; for(double x : *rows[r]) out << ' ' << x; out << '\n'; }
+  out << "rng " << S.rng << '\n';
+  out.close();
+  return out && std::rename(tmp.c_str(), path.c_str())==0;
+}
+
+static bool tuneLoad(const std::string& path,TuneState& S,size_t n){
+  std::ifstream in(path);
+  if(!in) return false;
+  std::string tag, group; int ver=0;
+  if(!(in >> tag >> ver) || tag!="dxtune" || ver!=2){ std::fprintf(stderr, "tune: %s is not a dxtune 2 checkpoint; starting afresh\n", path.c_str()); return false; }
+  in >> tag >> group >> tag >> S.gen >> tag >> S.seed >> tag >> S.games >> tag >> S.lambda >> tag >> S.sigma >> tag >> S.bestLoss;
+  if(group!=S.group){ std::fprintf(stderr, "tune: %s holds group %s, not %s; starting afresh\n", path.c_str(), group.c_str(), S.group.c_str()); return false; }
+  std::vector<double>* rows[] = {&S.mean, &S.C, &S.pc, &S.ps, &S.best};
+  for(int r=0;r<5;r++){ in >> tag; rows[r]->assign(n, 0.0); for(size_t k=0;k<n;k++) in >> (*rows[r])[k]; }
+  in >> tag >> S.rng;
+  return in && S.games > 0 && S.lambda >= 4;
+}
 
-  // HIGHSCORES
-  if(current==HIGHSCORES){
-    glColor3f(0.5f, 0.7f, 1.0f);
-    drawText(40, scrH-90, "HIGH SCORES (SCORE, TIME)");
+static int runTune(const std::string& group,int gens,int games,int pop,float targetTime,float targetRate,unsigned seed,const std::string& checkpoint){
+  headless = true;
+  std::vector<int> dims;
+  for(int k=0;k<TUNE_PARAMS;k++)
+    if(group=="all" || (group=="ai")==tuneParams[k].ai) dims.push_back(k);
+  if(group!="all" && group!="ai" && group!="game"){ std::fprintf(stderr, "tune: group must be game, ai or all\n"); return 1; }
+  const int n = (int)dims.size();
 
-    std::vector<Run> rows = history;
-    std::sort(rows.begin(), rows.end(), [](const Run& a, const Run& b){
-      if(a.s != b.s) return a.s > b.s;
-      return a.t < b.t;
-    });
+  // A resumed run continues with the seed, games and population it started
+  // with, or its common random numbers would not be the same games.
+  TuneState S; S.group = group;
+  bool resumed = !checkpoint.empty() && tuneLoad(checkpoint, S, n);
+  if(!resumed){ S = TuneState(); S.group = group; S.seed = seed; S.games = std::max(1, games); S.lambda = pop>0 ? std::max(4, pop) : 4 + (int)(3*std::log((double)n)); }
+  else if(S.seed!=seed || S.games!=std::max(1, games) || (pop>0 && S.lambda!=std::max(4, pop)))
+    std::printf("tune: %s was started with seed %u, %d games, population %d; using those\n", checkpoint.c_str(), S.seed, S.games, S.lambda);
+  seed = S.seed; games = S.games;
+  const int lambda = S.lambda, mu = lambda/2;
 
-    int y = scrH-130; int shown=0;
-    if(rows.empty()){
-      drawText(60, y, "NO SCORES YET");
-    } else {
-      for(size_t i=0;i<rows.size() && shown<15;i++){
-        char row[96];
-        std::snprintf(row,sizeof(row),"%2d) %6d PTS    %6.1FS", (int)i+1, rows[i].s, rows[i].t);
-        drawText(60, y, row); y -= 24; ++shown;
+  // Strategy constants (sep-CMA-ES defaults).
+  std::vector<double> w(mu);
+  for(int i=0;i<mu;i++) w[i] = std::log(mu+0.5) - std::log(i+1.0);
+  double wsum = std::accumulate(w.begin(), w.end(), 0.0), w2 = 0;
+  for(double& x : w){ x /= wsum; w2 += x*x; }
+  const double mueff = 1.0/w2, cs = (mueff+2)/(n+mueff+5), ds = 1 + 2*std::max(0.0, std::sqrt((mueff-1)/(n+1))-1) + cs;
+  const double cc = 4.0/(n+4), c1 = 2.0/((n+1.3)*(n+1.3)+mueff)*(n+2)/3.0;
+  const double cmu = std::min(1-c1, 2*(mueff-2+1/mueff)/((n+2.0)*(n+2.0)+mueff)*(n+2)/3.0);
+  const double chiN = std::sqrt((double)n)*(1 - 1.0/(4*n) + 1.0/(21.0*n*n));
+
+  Tuning baseT; AiPolicy baseP; float base[TUNE_PARAMS]; tuneGet(baseT, baseP, base);
+  auto norm = [&](int d,float x){ const TuneParam& t = tuneParams[dims[d]]; return (double)(x - t.lo)/(t.hi - t.lo); };
+  auto denorm = [&](const std::vector<double>& x,Tuning& T,AiPolicy& P){
+    float v[TUNE_PARAMS]; std::copy(base, base+TUNE_PARAMS, v);
+    for(int d=0;d<n;d++){ const TuneParam& t = tuneParams[dims[d]]; v[dims[d]] = t.lo + (float)clampv(x[d], 0.0, 1.0)*(t.hi - t.lo); }
+    tuneSet(v, T, P);
+  };
+
+  if(!resumed){
+    S.rng.seed(seed);
+    S.mean.resize(n); for(int d=0;d<n;d++) S.mean[d] = norm(d, base[dims[d]]);
+    S.C.assign(n, 1.0); S.pc.assign(n, 0.0); S.ps.assign(n, 0.0); S.best = S.mean;
+  } else std::printf("tune: resumed %s at generation %d (best loss %.5f)\n", checkpoint.c_str(), S.gen, S.bestLoss);
+  std::printf("tune: %s, %d parameters, population %d, %d games per candidate, target median %.0fs at %.0f%% cleared\n",
+              group.c_str(), n, lambda, games, targetTime, 100.0*targetRate);
+
+  std::normal_distribution<double> N01(0.0, 1.0);
+  std::vector<std::vector<double>> z(lambda, std::vector<double>(n)), y(lambda, std::vector<double>(n)), x(lambda, std::vector<double>(n));
+  std::vector<Tuning> candT(lambda); std::vector<AiPolicy> candP(lambda);
+  std::vector<TourneyGame> res((size_t)lambda*games);
+  std::vector<double> loss(lambda), median(lambda), rate(lambda);
+  auto t0 = std::chrono::steady_clock::now(); long long played = 0;
+  while(S.gen < gens){
+    N01.reset();   // its cached second draw is not checkpointed; only S.rng is
+    for(int i=0;i<lambda;i++){
+      for(int d=0;d<n;d++){ z[i][d] = N01(S.rng); y[i][d] = std::sqrt(S.C[d])*z[i][d]; x[i][d] = S.mean[d] + S.sigma*y[i][d]; }
+      denorm(x[i], candT[i], candP[i]);
+    }
+    uint32_t genSeed = seed + 0x85EBCA6Bu*(uint32_t)(S.gen+1);
+    parallelFor(lambda*games, 4, [&](int b,int e){
+      ++jobSerial; bool was = branchSim; branchSim = true; Tuning keep = tuning;
+      for(int k=b;k<e;k++){
+        int c = k/games, s = k%games;
+        tuning = candT[c];
+        newGameSeeded(genSeed + 0x9E3779B9u*(uint32_t)s);
+        while(current==PLAY && playTime < HEADLESS_MAX_TIME){ aiPolicyTick(candP[c], applyInput); updateGame(HEADLESS_DT); playTime += HEADLESS_DT; }
+        TourneyGame& r = res[k]; r.won = current==WIN; r.score = score; r.lives = lives; r.time = playTime;
       }
+      tuning = keep; branchSim = was; --jobSerial;
+    });
+    played += (long long)lambda*games;
+
+    for(int c=0;c<lambda;c++){
+      std::vector<float> clear;
+      for(int s=0;s<games;s++) if(res[(size_t)c*games+s].won) clear.push_back(res[(size_t)c*games+s].time);
+      std::sort(clear.begin(), clear.end());
+      median[c] = clear.empty() ? HEADLESS_MAX_TIME : clear[clear.size()/2]; rate[c] = (double)clear.size()/games;
+      double et = (median[c]-targetTime)/targetTime, er = (rate[c]-targetRate)/std::max(0.01f, targetRate);
+      loss[c] = et*et + er*er;
     }
+    std::vector<int> order(lambda); std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a,int b){ return loss[a] < loss[b]; });
+    if(loss[order[0]] < S.bestLoss){ S.bestLoss = loss[order[0]]; S.best = x[order[0]]; for(double& v : S.best) v = clampv(v, 0.0, 1.0); }
 
-    loadBest();
-    if(haveBest){
-      char b[96]; std::snprintf(b,sizeof(b),"BEST: %d PTS IN %.1FS", bestScore, bestTime);
-      glColor3f(0.3f,1.0f,0.3f); drawText(40, y-20, b);
-      glColor3f(0.5f, 0.7f, 1.0f);
+    std::vector<double> yw(n, 0.0), zw(n, 0.0);
+    for(int i=0;i<mu;i++) for(int d=0;d<n;d++){ yw[d] += w[i]*y[order[i]][d]; zw[d] += w[i]*z[order[i]][d]; }
+    double psn = 0;
+    for(int d=0;d<n;d++){
+      S.mean[d] = clampv(S.mean[d] + S.sigma*yw[d], 0.0, 1.0);
+      S.ps[d] = (1-cs)*S.ps[d] + std::sqrt(cs*(2-cs)*mueff)*zw[d]; psn += S.ps[d]*S.ps[d];
+    }
+    psn = std::sqrt(psn);
+    bool hsig = psn/std::sqrt(1 - std::pow(1-cs, 2.0*(S.gen+1))) < (1.4 + 2.0/(n+1))*chiN;
+    for(int d=0;d<n;d++){
+      S.pc[d] = (1-cc)*S.pc[d] + (hsig ? std::sqrt(cc*(2-cc)*mueff) : 0.0)*yw[d];
+      double rank = 0; for(int i=0;i<mu;i++) rank += w[i]*y[order[i]][d]*y[order[i]][d];
+      S.C[d] = (1-c1-cmu)*S.C[d] + c1*(S.pc[d]*S.pc[d] + (hsig ? 0.0 : cc*(2-cc)*S.C[d])) + cmu*rank;
     }
+    S.sigma = std::min(1.0, S.sigma*std::exp(cs/ds*(psn/chiN - 1)));
+    S.gen++;
 
-    glColor3f(1.0f,0.9f,0.2f); drawText(40, 60, "PRESS ENTER FOR MENU");
-    glutSwapBuffers(); return;
+    int b = order[0];
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+    std::printf("gen %d: best loss %.5f (median %.1fs, %.1f%% cleared) | generation median loss %.5f | sigma %.4f | best so far %.5f | %.0f games/s\n",
+                S.gen, loss[b], median[b], 100.0*rate[b], loss[order[lambda/2]], S.sigma, S.bestLoss, wall>0 ? played/wall : 0.0);
+    std::fflush(stdout);
+    if(!checkpoint.empty() && !tuneSave(checkpoint, S)) std::fprintf(stderr, "tune: cannot write %s\n", checkpoint.c_str());
   }
 
-  // GAME PLAY: draw bricks, paddle, ball, perks, bullets
-  for(size_t i=0;i<bricks.size();++i){
-    const Brick& b=bricks[i]; if(!b.alive) continue;
-    float multiplier = (b.hp == 2) ? 1.0f : 0.6f;
-    glColor3f(b.r * multiplier, b.g * multiplier, b.b * multiplier);
-    drawRectFilled(b.x, b.y, b.w, b.h);
-
-    glColor3f(0.1f, 0.1f, 0.1f);
-    float x0 = b.x - b.w/2.f, x1 = b.x + b.w/2.f;
-    float y0 = b.y - b.h/2.f, y1 = b.y + b.h/2.f;
-    glBegin(GL_LINE_LOOP);
-      glVertex2f(x0,y0); glVertex2f(x1,y0); glVertex2f(x1,y1); glVertex2f(x0,y1);
-    glEnd();
+  Tuning T; AiPolicy P; denorm(S.best, T, P);
+  float v[TUNE_PARAMS]; tuneGet(T, P, v);
+  std::printf("best (loss %.5f):\n", S.bestLoss);
+  for(int d=0;d<n;d++) std::printf("  %-12s %.4f\n", tuneParams[dims[d]].name, v[dims[d]]);
+  if(group!="ai"){
+    std::printf("  perk cuts   ");
+    for(int k=0;k<7;k++) std::printf(" %.3f", T.perkCut[k]);
+    std::printf("\n");
   }
+  return 0;
+}
 
-  glColor3f(0.2f, 0.5f, 0.9f);
-  drawRectFilled(paddle.pos.x, paddle.pos.y, paddle.w, paddle.h);
+// --- Terminal Play ---
+// Input for --term: raw-mode stdin with SGR mouse reporting, fed through the
+// GLUT callbacks so menus and recordings behave as in the window. Terminals
+// report no key releases, so an arrow counts as held until no press or
+// autorepeat has arrived for TERM_KEY_HOLD seconds; the mouse moves the
+// paddle exactly. --watch lets the autopilot play game after game.
+static const float TERM_KEY_HOLD = 0.12f;
+static volatile sig_atomic_t termQuit = 0;
+#ifdef __linux__
+static termios termSaved; static bool termRaw=false;
 
-  if(ball.fireball) glColor3f(1.0f,0.45f,0.15f);
-  else if(ball.through) glColor3f(0.9f,0.2f,1.0f);
-  else glColor3f(0.3f, 1.0f, 0.3f);
-  drawCircleFilled(ball.pos.x, ball.pos.y, ball.radius, 32);
+static void termRestore(){
+  if(!termRaw) return;
+  termRaw = false;
+  termWrite("\x1b[0m\x1b[?1003l\x1b[?1006l\x1b[?25h\x1b[?1049l");
+  tcsetattr(0, TCSAFLUSH, &termSaved);
+}
 
-  for(size_t i=0;i<perks.size();++i){
-    const Perk& p=perks[i]; if(!p.alive) continue;
-    glColor3f(0.8f, 0.8f, 0.8f);
-    drawRectFilled(p.pos.x, p.pos.y, p.size, p.size);
-    drawPerkIcon(p.type, p.pos.x, p.pos.y, 8.f);
+static void termStart(){
+  termWrite("\x1b[?1049h\x1b[?25l\x1b[?1003h\x1b[?1006h");   // alternate screen, hidden cursor, mouse motion
+  if(tcgetattr(0, &termSaved)==0){
+    termios t = termSaved;
+    t.c_lflag &= ~(ICANON | ECHO); t.c_iflag &= ~(ICRNL | IXON);
+    t.c_cc[VMIN] = 0; t.c_cc[VTIME] = 0;
+    tcsetattr(0, TCSAFLUSH, &t);
   }
+  termRaw = true;
+  std::atexit(termRestore);
+  std::signal(SIGINT, [](int){ termQuit = 1; });
+  std::signal(SIGTERM, [](int){ termQuit = 1; });
+}
 
-  for(size_t i=0;i<bullets.size();++i){
-    const Bullet& bu = bullets[i]; if(!bu.alive) continue;
-    glColor3f(1.0f, 0.9f, 0.2f);
-    drawRectFilled(bu.pos.x, bu.pos.y, bu.w, bu.h);
+// Window coordinates (GLUT convention, y down) of a 1-based terminal cell.
+static int termMouseX(int col){ return (int)((col-1-termOx+0.5f)/termScale); }
+static int termMouseY(int row){ return (int)(((row-1-termOy)*2.f+1.f)/termScale); }
+
+static void termPollInput(float now){
+  static float releaseAt[2] = {0.f, 0.f};   // LEFT, RIGHT
+  unsigned char buf[256]; ssize_t n = read(0, buf, sizeof(buf));
+  for(ssize_t i=0;i<n;i++){
+    unsigned char c = buf[i];
+    if(c==27 && i+2<n && buf[i+1]=='['){
+      if(buf[i+2]=='<'){                   // SGR mouse: ESC [ < b ; x ; y (M|m)
+        int v[3]={0,0,0}, k=0; ssize_t j=i+3;
+        for(; j<n && buf[j]!='M' && buf[j]!='m'; j++){
+          if(buf[j]==';'){ if(++k>2) break; } else v[k] = v[k]*10 + (buf[j]-'0');
+        }
+        if(j>=n) break;
+        int x = termMouseX(v[1]), y = termMouseY(v[2]);
+        if(v[0] & 32) onPassiveMotion(x, y);
+        else if(buf[j]=='M' && (v[0]&3)!=3) onMouse((v[0]&3)==2 ? GLUT_RIGHT_BUTTON : GLUT_LEFT_BUTTON, GLUT_DOWN, x, y);
+        i = j; continue;
+      }
+      int key = buf[i+2]=='A' ? GLUT_KEY_UP : buf[i+2]=='B' ? GLUT_KEY_DOWN : buf[i+2]=='C' ? GLUT_KEY_RIGHT : buf[i+2]=='D' ? GLUT_KEY_LEFT : 0;
+      i += 2;
+      if(!key) continue;
+      if(key==GLUT_KEY_LEFT || key==GLUT_KEY_RIGHT){
+        float& rel = releaseAt[key==GLUT_KEY_RIGHT];
+        if(rel <= 0.f) onSpKey(key, 0, 0);
+        rel = now + TERM_KEY_HOLD;
+      } else onSpKey(key, 0, 0);
+    }
+    else if(c=='\n') onKey('\r', 0, 0);
+    else onKey(c, 0, 0);
   }
+  for(int k=0;k<2;k++)
+    if(releaseAt[k] > 0.f && now >= releaseAt[k]){ releaseAt[k] = 0.f; onSpKeyUp(k ? GLUT_KEY_RIGHT : GLUT_KEY_LEFT, 0, 0); }
+}
+#endif
 
-  renderHUD();
+static int runTerm(bool watch, bool predict){
+#ifdef __linux__
+  headless = true;   // no GLUT: clock from steady_clock
+  backend = BACKEND_TERM;
+  termStart();
+  paddle.pos = {scrW/2.f, 48.f}; paddle.w = 120.f; paddle.h = 16.f; paddle.speed = 630.f;
+  ball.radius = 9.f; ball.speed = 320.f; resetBallOnPaddle();
+  const float frame = 1.f/60.f;
+  float next = nowSec(), prev = next;
+  while(!termQuit){
+    float now = nowSec();
+    termPollInput(now);
+    if(watch && current!=PLAY) newGame();
+    if(current==PLAY){
+      if(watch){ if(predict) autopilotPredict(); else autopilot(); }
+      float dt = clampv(now - prev, 0.f, REPLAY_MAX_DT);
+      recordTick(dt); updateGame(dt); perfMark(PH_NONE);
+      playTime += dt;
+      if(checkEvery) checkTick();
+    }
+    prev = now;
+    renderScene();
+    next += frame; float wait = next - nowSec();
+    if(wait > 0.f) std::this_thread::sleep_for(std::chrono::duration<float>(wait)); else next = nowSec();
+  }
+  termRestore();
+  std::printf("term: %dx%d cells, frames=%lld, %.0f bytes/frame (%.1f KB/s at 60 fps), %.0f cells/frame\n",
+              termCols, termRows, termFrames, termFrames ? (double)termBytes/termFrames : 0.0,
+              termFrames ? termBytes*60.0/termFrames/1024.0 : 0.0, termFrames ? (double)termCellsSent/termFrames : 0.0);
+  perfPrintSummary(stdout);
+  return 0;
+#else
+  std::fprintf(stderr, "--term: only supported on Linux\n"); (void)watch; (void)predict;
+  return 1;
+#endif
+}
 
-  // PAUSE SCREEN WITH OPTIONS
-  if(current==PAUSE){
-    glColor3f(0.9f,0.9f,0.9f);
-    drawText(scrW/2.f-40, scrH/2.f + 60, "== PAUSED ==");
+// --- Replay Benchmark ---
+// Plays recorded replays through updateGame() and the full render-command path
+// (null backend), so interactions between phases are measured together.
+struct BenchResult { std::string name; long long ticks; int score; double ticksPerSec, framesPerSec, p50us, p99us, maxus; };
 
-    // Options: Resume, Exit to Main Menu
-    const char* opts[] = {"[ RESUME ]", "[ EXIT TO MAIN MENU ]"};
-    for(int i=0;i<2;i++){
-      if(i==pauseMenuIndex) glColor3f(1.0f,0.9f,0.2f);
-      else glColor3f(0.6f,0.8f,1.0f);
-      float y = scrH/2.f + 20 - i*40.f;
-      drawText(scrW/2.f - (i==0?50:140), y, opts[i]);
+static double percentile(std::vector<double>& v, double q){
+  if(v.empty()) return 0.0;
+  size_t k = (size_t)(q*(double)(v.size()-1));
+  std::nth_element(v.begin(), v.begin()+k, v.end());
+  return v[k];
+}
+
+static BenchResult benchReplay(const std::string& name, const Replay& r){
+  typedef std::chrono::steady_clock clk;
+  BenchResult res; res.name = name; res.ticks = 0;
+  std::vector<double> lat; lat.reserve(r.dts.size());
+  double updSec=0.0, renSec=0.0, total=0.0;
+  replayRate = r.rate;
+  do {  // repeat short replays until the sample is long enough to be stable
+    newGameSeeded(r.seed);
+    size_t ev=0;
+    for(size_t t=0; t<r.dts.size() && current==PLAY; t++){
+      for(; ev<r.events.size() && r.events[ev].tick<=t; ev++) applyInput(r.events[ev].kind, r.events[ev].value);
+      auto t0 = clk::now();
+      updateGame(r.dts[t]); perfMark(PH_NONE); playTime += r.dts[t];
+      auto t1 = clk::now();
+      renderScene();
+      auto t2 = clk::now();
+      double u = std::chrono::duration<double>(t1-t0).count(), f = std::chrono::duration<double>(t2-t1).count();
+      updSec += u; renSec += f; lat.push_back((u+f)*1e6); ++res.ticks;
     }
-    drawText(scrW/2.f-140, scrH/2.f - 120, "Use UP/DOWN to select, ENTER or Left-Click to confirm.");
+    total = updSec + renSec;
+  } while(total < 0.25 && !r.dts.empty());
+  replayRate = 0;
+  res.score = score;
+  res.ticksPerSec  = updSec>0 ? res.ticks/updSec : 0.0;
+  res.framesPerSec = renSec>0 ? res.ticks/renSec : 0.0;
+  res.p50us = percentile(lat, 0.50); res.p99us = percentile(lat, 0.99);
+  res.maxus = lat.empty() ? 0.0 : *std::max_element(lat.begin(), lat.end());
+  return res;
+}
+
+// State forking: from every FORK_BENCH_STEP-th tick of a predictive game, a
+// three-way lookahead (hold left, nothing, hold right for FORK_BENCH_DEPTH
+// ticks), with the arena reset after each decision. Ticks are branch ticks
+// and latency is per decision. Every 16th decision replays a branch from the
+// same root to check that restores are exact, and the live state is also
+// deep-copied (vectors, wheel, rng) for comparison with a capture.
+static const int FORK_BENCH_DECISIONS = 400, FORK_BENCH_DEPTH = 60, FORK_BENCH_STEP = 8;
+struct ForkBench { double captureNs, restoreNs, deepNs, pagesPerCapture, pagesPerState, arenaKB; int mismatches; };
+
+static BenchResult benchFork(ForkBench& fb){
+  typedef std::chrono::steady_clock clk;
+  struct Deep { std::vector<Brick> b; std::vector<Perk> p; std::vector<Bullet> u; std::vector<Effect> fp; std::vector<int> ff;
+                std::unordered_map<uint64_t,int> fi; std::mt19937 r; };
+  BenchResult res; res.name = "fork-3x60-lookahead"; res.ticks = 0; res.framesPerSec = 0.0;
+  std::vector<double> lat; lat.reserve(FORK_BENCH_DECISIONS);
+  StateArena A; double sec=0.0, capSec=0.0, resSec=0.0, deepSec=0.0, arena=0.0;
+  long long caps=0, restores=0, deeps=0, pages=0, copied0=statePagesCopied;
+  fb = ForkBench(); newGameSeeded(7u); branchSim = true;
+  auto branch = [&](int a){
+    applyInput(IN_LEFT, a==0 ? 1.f : 0.f); applyInput(IN_RIGHT, a==2 ? 1.f : 0.f);
+    if(ball.stuck) applyInput(IN_LAUNCH_KEY, 0.f);
+    for(int t=0;t<FORK_BENCH_DEPTH && current==PLAY;t++){ updateGame(HEADLESS_DT); playTime += HEADLESS_DT; ++res.ticks; }
+  };
+  for(int d=0; d<FORK_BENCH_DECISIONS && current==PLAY; d++){
+    auto t0 = clk::now();
+    GameState root, leaf; captureState(A, root); ++caps;
+    for(int a=0;a<3;a++){
+      auto r0 = clk::now(); restoreState(root); resSec += std::chrono::duration<double>(clk::now()-r0).count(); ++restores;
+      branch(a);
+      auto c0 = clk::now(); captureState(A, leaf); capSec += std::chrono::duration<double>(clk::now()-c0).count(); ++caps;
+      pages += leaf.bricks.pages() + leaf.perks.pages() + leaf.bullets.pages() + 2;
+    }
+    restoreState(root);
+    arena = std::max(arena, (double)A.bytes());
+    double dt = std::chrono::duration<double>(clk::now()-t0).count(); sec += dt; lat.push_back(dt*1e6);
+
+    if(d%16==0){  // the same branch twice from one root must end identically
+      branch(1); int s1=score, n1=bricksAlive; Vec2 b1=ball.pos;
+      restoreState(root); branch(1);
+      if(score!=s1 || bricksAlive!=n1 || ball.pos.x!=b1.x || ball.pos.y!=b1.y) ++fb.mismatches;
+      restoreState(root);
+      auto k0 = clk::now();
+      Deep c; c.b=bricks; c.p=perks; c.u=bullets; c.fp=fxPool; c.ff=fxFree; c.fi=fxIndex; c.r=rng;
+      deepSec += std::chrono::duration<double>(clk::now()-k0).count(); ++deeps;
+      if(c.b.size()!=bricks.size()) ++fb.mismatches;   // keeps the copy live
+    }
+
+    float target = predictTarget();
+    applyInput(IN_LEFT, target < paddle.pos.x - 4.f ? 1.f : 0.f); applyInput(IN_RIGHT, target > paddle.pos.x + 4.f ? 1.f : 0.f);
+    if(ball.stuck) applyInput(IN_LAUNCH_KEY, 0.f);
+    for(int t=0;t<FORK_BENCH_STEP && current==PLAY;t++){ updateGame(HEADLESS_DT); playTime += HEADLESS_DT; }
+    A.reset();
   }
+  branchSim = false;
+  res.score = score;
+  res.ticksPerSec = sec>0 ? res.ticks/sec : 0.0;
+  res.p50us = percentile(lat, 0.50); res.p99us = percentile(lat, 0.99);
+  res.maxus = lat.empty() ? 0.0 : *std::max_element(lat.begin(), lat.end());
+  long long leaves = caps - (long long)lat.size();
+  fb.captureNs = leaves ? capSec*1e9/leaves : 0.0; fb.restoreNs = restores ? resSec*1e9/restores : 0.0;
+  fb.deepNs = deeps ? deepSec*1e9/deeps : 0.0; fb.arenaKB = arena/1024.0;
+  fb.pagesPerCapture = caps ? (double)(statePagesCopied-copied0)/caps : 0.0; fb.pagesPerState = leaves ? (double)pages/leaves : 0.0;
+  return res;
+}
+
+// Script VM cost: SCRIPT_BENCH_BRICKS bricks running a timer/shield/regen
+// on_tick handler, timed per tick with nothing else in the loop. The row's
+// frames/s column is left at 0 (there is no render pass).
+static const int SCRIPT_BENCH_BRICKS = 10000, SCRIPT_BENCH_TICKS = 600;
 
-  if(current==WIN){ glColor3f(0.3f,1.0f,0.3f); drawText(scrW/2.f-80, scrH/2.f, "[ LEVEL CLEARED! ]"); drawText(scrW/2.f-120, scrH/2.f-30, "PRESS ENTER FOR MENU"); }
-  if(current==GAMEOVER){ glColor3f(1.0f,0.3f,0.3f); drawText(scrW/2.f-60, scrH/2.f, "[ GAME OVER ]"); drawText(scrW/2.f-120, scrH/2.f-30, "PRESS ENTER FOR MENU"); }
+static BenchResult benchScripts(double* nsPerRun, double* nsPerOp){
+  typedef std::chrono::steady_clock clk;
+  static const char* src[] = {
+    "v0 = v0 + dt",
+    "shield = v0 - 2 * v1 > 1",
+    "if shield and hp > 0",
+    "  v1 = v1 + 1",
+    "else",
+    "  v2 = v2 + dt * 0.5",
+    "end",
+    "if hp < 2 and v0 > 3",
+    "  hp = hp + 1",
+    "  v0 = 0",
+    "  v1 = 0",
+    "end",
+    "end"
+  };
+  ScriptCompiler sc; sc.begin(); bool done=false;
+  for(const char* l : src) if(!sc.line(l, &done)){ std::fprintf(stderr, "bench: script: %s\n", sc.err.c_str()); break; }
+  BrickType bt; bt.on[EV_TICK]=sc.handler(); brickTypes.push_back(bt);
+
+  bricks.clear(); tickBricks.clear(); dirtyBricks.clear(); forkSynced=false;
+  for(int i=0;i<SCRIPT_BENCH_BRICKS;i++){
+    Brick b; b.x = 6.f + (i%100)*8.8f; b.y = 120.f + (i/100)*5.f; b.w=8.f; b.h=4.f; b.alive=true; b.hp=1;
+    b.r=b.g=b.b=0.8f; b.score=0; b.type=(int)brickTypes.size()-1; std::fill(b.var, b.var+4, 0.f);
+    b.var[0] = (i%97)*0.03f;   // stagger the timers so branches vary between bricks
+    bricks.push_back(b); tickBricks.push_back(i);
+  }
+  bricksAlive = (int)bricks.size(); gridBuild(); playTime = 0.f;
 
-  glutSwapBuffers();
+  BenchResult res; res.name = "vm-10k-bricks"; res.ticks = 0; res.score = 0; res.framesPerSec = 0.0;
+  std::vector<double> lat; lat.reserve(SCRIPT_BENCH_TICKS);
+  long long ops0 = scriptOps, runs0 = scriptRuns; double sec = 0.0;
+  for(int t=0;t<SCRIPT_BENCH_TICKS;t++){
+    auto t0 = clk::now();
+    scriptTick(1.f/120.f);
+    double d = std::chrono::duration<double>(clk::now()-t0).count();
+    sec += d; lat.push_back(d*1e6); ++res.ticks;
+    dirtyBricks.clear(); playTime += 1.f/120.f;
+  }
+  long long runs = scriptRuns-runs0, ops = scriptOps-ops0;
+  res.ticksPerSec = sec>0 ? res.ticks/sec : 0.0;
+  res.p50us = percentile(lat, 0.50); res.p99us = percentile(lat, 0.99);
+  res.maxus = lat.empty() ? 0.0 : *std::max_element(lat.begin(), lat.end());
+  *nsPerRun = runs ? sec*1e9/runs : 0.0; *nsPerOp = ops ? sec*1e9/ops : 0.0;
+  brickTypes.pop_back(); bricks.clear(); tickBricks.clear(); bricksAlive=0;
+  return res;
 }
 
-// --- GLUT Callbacks ---
+// Baseline file: one "name ticks/s frames/s p99us" line per replay.
+static int runBench(const std::vector<std::string>& files, const std::string& baseline, const std::string& saveTo){
+  headless = true;
+  std::vector<BenchResult> results;
+  for(const std::string& path : files){
+    Replay r;
+    if(!loadReplay(path, r)){ std::fprintf(stderr, "bench: cannot load %s\n", path.c_str()); return 2; }
+    std::string name = path.substr(path.find_last_of("/\\")+1);
+    results.push_back(benchReplay(name, r));
+  }
+  ForkBench fork; results.push_back(benchFork(fork));
+  double vmNsRun=0.0, vmNsOp=0.0;
+  results.push_back(benchScripts(&vmNsRun, &vmNsOp));
+  const double TOL = 0.10;
+  int regressions = 0;
+  std::ifstream base(baseline.c_str());
+  std::vector<BenchResult> prev; BenchResult b;
+  while(base >> b.name >> b.ticksPerSec >> b.framesPerSec >> b.p99us) prev.push_back(b);
+  std::printf("%-28s %8s %10s %12s %12s %9s %9s %9s\n", "replay", "score", "ticks", "ticks/s", "frames/s", "p50us", "p99us", "maxus");
+  for(const BenchResult& r : results){
+    std::printf("%-28s %8d %10lld %12.0f %12.0f %9.2f %9.2f %9.2f", r.name.c_str(), r.score, r.ticks, r.ticksPerSec, r.framesPerSec, r.p50us, r.p99us, r.maxus);
+    for(const BenchResult& p : prev){
+      if(p.name != r.name) continue;
+      bool worse = r.ticksPerSec < p.ticksPerSec*(1-TOL) || r.framesPerSec < p.framesPerSec*(1-TOL) || r.p99us > p.p99us*(1+TOL);
+      std::printf("  [%+.1f%% ticks/s, %+.1f%% frames/s, %+.1f%% p99]%s",
+                  100.0*(r.ticksPerSec/p.ticksPerSec-1), p.framesPerSec>0 ? 100.0*(r.framesPerSec/p.framesPerSec-1) : 0.0,
+                  100.0*(r.p99us/p.p99us-1), worse ? " REGRESSION" : "");
+      if(worse) ++regressions;
+    }
+    std::printf("\n");
+  }
+  std::printf("state fork: capture %.0f ns (%.2f of %.1f pages copied), restore %.0f ns, deep copy %.0f ns, arena %.1f KB/decision, %d mismatches\n",
+              fork.captureNs, fork.pagesPerCapture, fork.pagesPerState, fork.restoreNs, fork.deepNs, fork.arenaKB, fork.mismatches);
+  std::printf("script vm: %d bricks, %.1f ns/handler, %.2f ns/instruction\n", SCRIPT_BENCH_BRICKS, vmNsRun, vmNsOp);
+  perfPrintSummary(stdout);
+  if(!saveTo.empty()){
+    std::ofstream out(saveTo.c_str());
+    for(const BenchResult& r : results) out << r.name << ' ' << r.ticksPerSec << ' ' << r.framesPerSec << ' ' << r.p99us << '\n';
+  }
+  return regressions ? 1 : 0;
+}
 
-static void onDisplay(){ renderScene(); }
+// --- Score Verification ---
+// --verify FILES: the server-side check for submitted runs. Each replay is
+// re-simulated headless, one whole game per job, and must reproduce every
+// link of its hash chain, end exactly on its last tick, and finish with the
+// claimed score and playTime. A forged run is rejected at its first bad link,
+// or at the first tick whose dt or paddle input no live game could produce.
+// Runs that pass enter the in-memory leaderboard (history), which stands in
+// for the real one, and the top of it is printed.
+enum VerifyStatus { VERIFY_OK, VERIFY_UNREADABLE, VERIFY_UNSIGNED, VERIFY_CHAIN, VERIFY_LENGTH, VERIFY_SCORE, VERIFY_TIME, VERIFY_INPUT };
+static const char* verifyNames[] = {"ok", "unreadable", "no claim (DXR1)", "hash chain", "length", "score", "playTime", "bad input"};
+struct VerifyResult { VerifyStatus status; uint32_t tick; int score; float playTime; Run claim; };
 
-static void onIdle(){
-  if(current==PLAY){
-    static float prev = nowSec();
-    float t = nowSec(); float dt = t - prev; prev = t;
-    if(dt<0.f) dt=0.f; if(dt>0.03f) dt=0.03f;
+static VerifyResult verifyReplay(const Replay& r){
+  VerifyResult v = {VERIFY_OK, 0, 0, 0.f, {r.playTime, r.score}};
+  if(!r.claimed){ v.status = VERIFY_UNSIGNED; return v; }
+  ++jobSerial; resimulating = true; replayRate = r.rate;
+  newGameSeeded(r.seed);
+  uint32_t t = 0, n = (uint32_t)r.dts.size(); size_t ev = 0; uint64_t link = r.seed;
+  for(; t<n; t++){
+    for(; ev<r.events.size() && r.events[ev].tick<=t; ev++){
+      const InputEvent& e = r.events[ev];
+      if(e.kind==IN_PADDLE_X && !std::isfinite(e.value)){ v.status = VERIFY_INPUT; break; }
+      applyInput(e.kind, e.value);
+    }
+    if(v.status!=VERIFY_OK) break;
+    if(t % REPLAY_CHAIN_TICKS == 0){
+      size_t k = t / REPLAY_CHAIN_TICKS; link = replayLink(link);
+      if(k >= r.chain.size() || r.chain[k] != link){ v.status = VERIFY_CHAIN; break; }
+    }
+    float dt = r.dts[t];   // negative dts run the ball backwards, huge ones tunnel it
+    if(!std::isfinite(dt) || dt<0.f || dt>REPLAY_MAX_DT){ v.status = VERIFY_INPUT; break; }
     updateGame(dt);
+    if(current!=PLAY){ t++; break; }   // the claim is taken inside the final tick
+    playTime += r.dts[t];
   }
-  glutPostRedisplay();
+  v.tick = t; v.score = score; v.playTime = playTime;
+  if(v.status==VERIFY_OK){
+    if(t!=n || r.chain.size()!=(n+REPLAY_CHAIN_TICKS-1)/REPLAY_CHAIN_TICKS) v.status = VERIFY_LENGTH;
+    else if(score!=r.score) v.status = VERIFY_SCORE;
+    else if(playTime!=r.playTime) v.status = VERIFY_TIME;
+  }
+  resimulating = false; replayRate = 0; --jobSerial;
+  return v;
 }
 
-static void onReshape(int w,int h){
-  scrW=w; scrH=h; glViewport(0,0,w,h);
-  glMatrixMode(GL_PROJECTION); glLoadIdentity();
-  gluOrtho2D(0, (GLdouble)w, 0, (GLdouble)h);
-  glMatrixMode(GL_MODELVIEW); glLoadIdentity();
+static int runVerify(const std::vector<std::string>& files){
+  headless = true; levelIndex = -1;   // a replay holds only the seed, so it implies the built-in layout
+  int n = (int)files.size();
+  std::vector<VerifyResult> res(n);
+  double t0 = nowSec();
+  parallelFor(n, 1, [&](int b,int e){
+    for(int i=b;i<e;i++){
+      Replay r;
+      if(loadReplay(files[i], r)) res[i] = verifyReplay(r);
+      else res[i] = VerifyResult{VERIFY_UNREADABLE, 0, 0, 0.f, {0.f, 0}};
+    }
+  });
+  double wall = nowSec() - t0, gameSec = 0.0; int ok = 0;
+  for(int i=0;i<n;i++){
+    const VerifyResult& v = res[i]; gameSec += v.playTime;
+    std::string name = files[i].substr(files[i].find_last_of("/\\")+1);
+    if(v.status==VERIFY_OK){
+      ++ok; history.push_back(v.claim);
+      std::printf("%-28s ok      score=%d time=%.2fs\n", name.c_str(), v.claim.s, v.claim.t);
+    } else std::printf("%-28s REJECT  %s at tick %u (claimed score=%d time=%.2fs, got %d in %.2fs)\n",
+                       name.c_str(), verifyNames[v.status], v.tick, v.claim.s, v.claim.t, v.score, v.playTime);
+  }
+  std::printf("verify: %d/%d ok, %.1f game-minutes in %.3fs = %.0fx real time, %.0f runs/min on %d workers\n",
+              ok, n, gameSec/60.0, wall, wall>0 ? gameSec/wall : 0.0, wall>0 ? n*60.0/wall : 0.0, jobWorkers);
+  heatFinish(n);
+  loadBest();
+  std::vector<Run> board = history;
+  std::sort(board.begin(), board.end(), [](const Run& a, const Run& b){ return a.s!=b.s ? a.s > b.s : a.t < b.t; });
+  for(size_t k=0;k<board.size() && k<10;k++) std::printf("  #%-2d %8d %8.2fs\n", (int)k+1, board[k].s, board[k].t);
+  return ok==n ? 0 : 1;
 }
 
-static void onKey(unsigned char key, int, int){
-  // Top-level MENU input
-  if(current==MENU){
-    if(key=='\r' || key=='\n'){
-      const char* itemsResume[] = {"[ RESUME ]","[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
-      const char* itemsFresh[]  = {"[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
-      const char** items = canResume ? itemsResume : itemsFresh;
-      int itemCount = canResume ? 5 : 4;
-      if(menuIndex>=0 && menuIndex<itemCount){
-        std::string it = items[menuIndex];
-        if(it=="[ RESUME ]" && canResume) current=PLAY;
-        else if(it=="[ START NEW GAME ]") newGame();
-        else if(it=="[ HIGH SCORES ]") current=HIGHSCORES;
-        else if(it=="[ HELP ]") current=HELP;
-        else if(it=="[ EXIT ]") std::exit(0);
-      }
-    }
-    if(key==27) std::exit(0);
-    return;
+// --- Batched Lane-Parallel Simulation ---
+// Steps up to BATCH_MAX games in lockstep for RL / Monte Carlo runs. Per-game
+// state is laid out SoA (lane i = game i) in fixed arrays, and every stage is
+// a straight loop over lanes using selects and bitwise masks instead of
+// branches, so the compiler vectorizes it (build with -O3 -march=native to
+// get wide vectors). Divergent events (brick hits, perk spawns, lost lives)
+// are lane masks; a brick's resolve pass only runs when some lane touched it.
+// All lanes play the standard layout: geometry is shared and per-game brick
+// state is two bitsets (alive, still at 2 hp). Lanes are driven by the
+// autopilot policy and draw from a per-lane xorshift generator, so results
+// match updateGame() statistically rather than bit-for-bit. No bullets are
+// simulated (the autopilot never fires) and at most BATCH_PERKS perks fall
+// per game at once. Finished lanes are refilled with the next game.
+static const int BATCH_MAX   = 1024;
+static const int BATCH_PERKS = 8;
+static const int BATCH_WORDS = 2;   // 128 brick bits per game
+
+struct BatchSim {
+  int K, NB;
+  float bx[BATCH_MAX], by[BATCH_MAX], vx[BATCH_MAX], vy[BATCH_MAX], speed[BATCH_MAX];
+  float px[BATCH_MAX], pw[BATCH_MAX], widthT[BATCH_MAX], throughT[BATCH_MAX], fireT[BATCH_MAX];
+  float gain[BATCH_MAX], time[BATCH_MAX], lostX[BATCH_MAX];   // lostX: ball x where the last life was lost (heatmaps)
+  int   lives[BATCH_MAX], score[BATCH_MAX], done[BATCH_MAX];  // done: 0 playing, 1 won, 2 lost
+  int   live[BATCH_MAX], active[BATCH_MAX], hitMask[BATCH_MAX], spawnAt[BATCH_MAX];
+  uint32_t seed[BATCH_MAX];
+  uint64_t alive[BATCH_WORDS][BATCH_MAX], hp2[BATCH_WORDS][BATCH_MAX];
+  uint64_t touch[BATCH_WORDS][BATCH_MAX];   // bricks the ball overlapped last tick (contact cache)
+  float pkx[BATCH_PERKS][BATCH_MAX], pky[BATCH_PERKS][BATCH_MAX];
+  int   pkt[BATCH_PERKS][BATCH_MAX];   // perk type, -1 = free slot
+  // shared brick geometry
+  float kx0[64*BATCH_WORDS], kx1[64*BATCH_WORDS], ky0[64*BATCH_WORDS], ky1[64*BATCH_WORDS];
+  int   kscore[64*BATCH_WORDS];
+  uint64_t startAlive[BATCH_WORDS], startHp2[BATCH_WORDS];
+};
+
+static inline float laneRand(uint32_t& s){ s ^= s<<13; s ^= s>>17; s ^= s<<5; return (float)(s>>8)*(1.f/16777216.f); }
+
+static void batchResetLane(BatchSim& S,int i,uint32_t seed){
+  S.seed[i] = seed | 1u;
+  S.bx[i]=scrW/2.f; S.by[i]=0.f; S.vx[i]=0.f; S.vy[i]=0.f; S.speed[i]=320.f;
+  S.px[i]=scrW/2.f; S.pw[i]=120.f; S.widthT[i]=0.f; S.throughT[i]=0.f; S.fireT[i]=0.f;
+  S.gain[i]=0.f; S.time[i]=0.f; S.lives[i]=3; S.score[i]=0; S.done[i]=0;
+  for(int w=0;w<BATCH_WORDS;w++){ S.alive[w][i]=S.startAlive[w]; S.hp2[w][i]=S.startHp2[w]; S.touch[w][i]=0; }
+  for(int k=0;k<BATCH_PERKS;k++) S.pkt[k][i] = -1;
+}
+
+static void batchInit(BatchSim& S,int K){
+  S.K = std::min(K, BATCH_MAX);
+  buildBricks();
+  S.NB = (int)std::min(bricks.size(), (size_t)64*BATCH_WORDS);
+  for(int w=0;w<BATCH_WORDS;w++){ S.startAlive[w]=0; S.startHp2[w]=0; }
+  for(int j=0;j<S.NB;j++){
+    const Brick& b = bricks[j];
+    S.kx0[j]=b.x-b.w/2.f; S.kx1[j]=b.x+b.w/2.f; S.ky0[j]=b.y-b.h/2.f; S.ky1[j]=b.y+b.h/2.f; S.kscore[j]=b.score;
+    S.startAlive[j/64] |= 1ull<<(j%64);
+    if(b.hp==2) S.startHp2[j/64] |= 1ull<<(j%64);
   }
+}
 
-  // HELP or HIGHSCORES return to menu
-  if(current==HELP || current==HIGHSCORES){
-    if(key=='\r' || key=='\n' || key==27) current=MENU;
-    return;
+static void batchStep(BatchSim& S,float dt){
+  const int K = S.K; const float R = 9.f, PY = 48.f, PH = 16.f, W = (float)scrW, Hs = (float)scrH;
+  const float SY = PY + PH/2.f + R + 1.f, LX = 0.2f/std::sqrt(1.04f), LY = 1.f/std::sqrt(1.04f);
+  const float gainRate = tuning.gainRate, speedRate = tuning.speedRate;
+
+  // Timers, speed gain, autopilot paddle (same policy as autopilot()) and launch.
+  for(int i=0;i<K;i++){
+    int on = S.done[i]==0; S.live[i] = on;
+    float d = on ? dt : 0.f;
+    S.time[i] += d; S.gain[i] += d*gainRate; S.speed[i] += d*speedRate;
+    S.throughT[i] = std::max(0.f, S.throughT[i]-d); S.fireT[i] = std::max(0.f, S.fireT[i]-d);
+    float w0 = S.widthT[i], w1 = std::max(0.f, w0-d); S.widthT[i] = w1;
+    S.pw[i] = (w0>0.f) & (w1<=0.f) ? 120.f : S.pw[i];
+    float dir = (S.bx[i] < S.px[i]-4.f) ? -1.f : (S.bx[i] > S.px[i]+4.f) ? 1.f : 0.f;
+    S.px[i] = clampv(S.px[i] + dir*630.f*d, S.pw[i]/2.f+6.f, W-S.pw[i]/2.f-6.f);
+    int stuck = (S.vx[i]==0.f) & (S.vy[i]==0.f);   // stuck balls launch straight away
+    S.vx[i] = on & stuck ? LX*S.speed[i] : S.vx[i];
+    S.vy[i] = on & stuck ? LY*S.speed[i] : S.vy[i];
+    S.bx[i] = stuck ? S.px[i] : S.bx[i];
+    S.by[i] = stuck ? SY : S.by[i];
   }
 
-  // WIN or GAMEOVER: Enter -> menu
-  if(current==WIN || current==GAMEOVER){
-    if(key=='\r' || key=='\n') current=MENU;
-    return;
+  // Ball movement, walls, bottom (a lost life masks the rest of the tick), paddle.
+  for(int i=0;i<K;i++){
+    float d = S.live[i] ? dt : 0.f;
+    float x = S.bx[i] + S.vx[i]*d, y = S.by[i] + S.vy[i]*d, avx = std::fabs(S.vx[i]);
+    S.vx[i] = (x-R < 0.f) ? avx : (x+R > W) ? -avx : S.vx[i];
+    x = clampv(x, R, W-R);
+    S.vy[i] = (y+R > Hs) ? -std::fabs(S.vy[i]) : S.vy[i];
+    y = std::min(y, Hs-R);
+    int lost = S.live[i] & (int)(y-R < 0.f);
+    int act = S.live[i] & !lost; S.active[i] = act; S.lostX[i] = x;
+    float hw = S.pw[i]/2.f;
+    float cx = clampv(x, S.px[i]-hw, S.px[i]+hw), cy = clampv(y, PY-PH/2.f, PY+PH/2.f);
+    float dx = x-cx, dy = y-cy, d2 = dx*dx+dy*dy;
+    int hit = act & (int)(d2 <= R*R);
+    float dd = std::sqrt(std::max(d2, 1e-6f)), id = dd>1e-4f ? 1.f/dd : 0.f;
+    float nx = dx*id, ny = dd>1e-4f ? dy*id : 1.f, pen = R-dd;
+    x = hit ? x+nx*pen : x; y = hit ? y+ny*pen : y;
+    float rel = clampv((x-S.px[i])/hw, -1.f, 1.f), il = 1.f/std::sqrt(rel*rel+1.44f);
+    S.vx[i] = hit ? rel*il*S.speed[i] : S.vx[i];
+    S.vy[i] = hit ? 1.2f*il*S.speed[i] : S.vy[i];
+    // a lost life resets paddle and ball; zero lives ends the game
+    int nl = S.lives[i] - lost; S.lives[i] = nl;
+    S.done[i] = lost & (int)(nl<=0) ? 2 : S.done[i];
+    S.px[i] = lost ? W/2.f : S.px[i]; S.pw[i] = lost ? 120.f : S.pw[i]; S.widthT[i] = lost ? 0.f : S.widthT[i];
+    S.throughT[i] = lost ? 0.f : S.throughT[i]; S.fireT[i] = lost ? 0.f : S.fireT[i];
+    S.speed[i] = lost ? 320.f+S.gain[i] : S.speed[i];
+    S.vx[i] = lost ? 0.f : S.vx[i]; S.vy[i] = lost ? 0.f : S.vy[i];
+    S.bx[i] = lost ? W/2.f : x; S.by[i] = lost ? SY : y;
   }
+  if(heatOn) for(int i=0;i<K;i++) if(S.live[i] & !S.active[i]) heatDeath(S.lostX[i]);
 
-  // Toggle Pause (P or Esc)
-  if(key==27 || key=='p' || key=='P'){
-    if(current==PLAY){ current=PAUSE; canResume=true; pauseMenuIndex=0; }
-    else if(current==PAUSE){ current=PLAY; }
-    return;
+  // Bricks: outer loop over the shared geometry, inner loops over lanes. The
+  // overlap test is a pure vector pass producing an overlap mask; the resolve
+  // pass (contact cache, reflection, scoring, bit updates) only runs for
+  // bricks where some lane's contact began or ended. As in updateGame, only
+  // entering contacts (overlapping now, not last tick) deal damage.
+  for(int i=0;i<K;i++) S.spawnAt[i] = -1;
+  for(int j=0;j<S.NB;j++){
+    const int wd = j/64, sh = j%64; const uint64_t bit = 1ull<<sh;
+    const float x0=S.kx0[j], x1=S.kx1[j], y0=S.ky0[j], y1=S.ky1[j]; const int pts = S.kscore[j];
+    int any = 0;
+    for(int i=0;i<K;i++){
+      float cx = clampv(S.bx[i], x0, x1), cy = clampv(S.by[i], y0, y1);
+      float dx = S.bx[i]-cx, dy = S.by[i]-cy;
+      int h = S.active[i] & (int)((S.alive[wd][i]>>sh) & 1u) & (int)(dx*dx+dy*dy <= R*R);
+      S.hitMask[i] = h; any |= h ^ (int)((S.touch[wd][i]>>sh) & 1u);
+    }
+    if(!any) continue;
+    if(heatOn) for(int i=0;i<K;i++) if(S.hitMask[i] & !(int)((S.touch[wd][i]>>sh) & 1u)) heatImpact(S.bx[i], S.by[i]);
+    for(int i=0;i<K;i++){
+      int h = S.hitMask[i], hit = h & !(int)((S.touch[wd][i]>>sh) & 1u), two = (int)((S.hp2[wd][i]>>sh) & 1u);
+      S.touch[wd][i] = h ? (S.touch[wd][i] | bit) : (S.touch[wd][i] & ~bit);
+      S.hp2[wd][i]   = hit ? (S.hp2[wd][i] & ~bit) : S.hp2[wd][i];
+      S.alive[wd][i] = hit & !two ? (S.alive[wd][i] & ~bit) : S.alive[wd][i];
+      S.spawnAt[i]   = hit & !two ? j : S.spawnAt[i];
+      S.score[i]    += hit ? pts : 0;
+      float cx = clampv(S.bx[i], x0, x1), cy = clampv(S.by[i], y0, y1);
+      float dx = S.bx[i]-cx, dy = S.by[i]-cy, d2 = dx*dx+dy*dy;
+      int refl = hit & (int)(S.throughT[i]<=0.f) & (int)(S.fireT[i]<=0.f);
+      float dd = std::sqrt(std::max(d2, 1e-6f)), id = dd>1e-4f ? 1.f/dd : 0.f;
+      float nx = dx*id, ny = dd>1e-4f ? dy*id : 1.f, pen = R-dd;
+      float s = std::sqrt(S.vx[i]*S.vx[i]+S.vy[i]*S.vy[i]), is = s>1e-6f ? 1.f/s : 0.f;
+      float ux = S.vx[i]*is, uy = S.vy[i]*is, dn = ux*nx+uy*ny;
+      float rx = ux-2.f*dn*nx, ry = uy-2.f*dn*ny, rl = std::sqrt(rx*rx+ry*ry), ir = rl>1e-6f ? 1.f/rl : 0.f;
+      refl &= (int)(s>1e-6f);
+      S.bx[i] = refl ? S.bx[i]+nx*pen : S.bx[i]; S.by[i] = refl ? S.by[i]+ny*pen : S.by[i];
+      refl &= (int)(dn < 0.f);   // only reflect when moving into the contact
+      S.vx[i] = refl ? rx*ir*S.speed[i] : S.vx[i];
+      S.vy[i] = refl ? ry*ir*S.speed[i] : S.vy[i];
+    }
   }
 
-  // If paused, allow keyboard selection
-  if(current==PAUSE){
-    if(key=='\r' || key=='\n'){
-      if(pauseMenuIndex==0){ current=PLAY; }
-      else if(pauseMenuIndex==1){ exitToMenu(); }
+  // Perk spawns: rare, so a scalar pass over the lanes that destroyed a brick,
+  // with the same odds as maybeSpawnPerk().
+  for(int i=0;i<K;i++){
+    int j = S.spawnAt[i]; if(j<0) continue;
+    if(laneRand(S.seed[i]) >= tuning.perkChance) continue;
+    int t = perkRoll[perkRollIndex(laneRand(S.seed[i]))];
+    for(int k=0;k<BATCH_PERKS;k++) if(S.pkt[k][i] < 0){
+      S.pkt[k][i] = t; S.pkx[k][i] = (S.kx0[j]+S.kx1[j])/2.f; S.pky[k][i] = (S.ky0[j]+S.ky1[j])/2.f; break;
     }
-    // also support single-key shortcuts
-    if(key=='r' || key=='R'){ current=PLAY; }
-    if(key=='e' || key=='E'){ exitToMenu(); }
-    return;
   }
 
-  if(current!=PLAY) return;
+  // Perk fall and collection, one slot at a time across all lanes.
+  for(int k=0;k<BATCH_PERKS;k++){
+    for(int i=0;i<K;i++){
+      int t = S.pkt[k][i];
+      int on = S.active[i] & (int)(S.done[i]==0) & (int)(t>=0);
+      float y = S.pky[k][i] - (on ? 150.f*dt : 0.f); S.pky[k][i] = y;
+      int gone = on & (int)(y < -30.f);
+      if(gone && heatOn) heatPerkMiss(S.pkx[k][i]);
+      int got = on & !gone & (int)(std::fabs(S.pkx[k][i]-S.px[i]) <= S.pw[i]/2.f+9.f) & (int)(std::fabs(y-PY) <= PH/2.f+9.f);
+      S.pkt[k][i] = gone | got ? -1 : t;
+      S.lives[i] = got & (int)(t==EXTRA_LIFE) ? std::min(S.lives[i]+1, MAX_LIVES) : S.lives[i];
+      S.speed[i] *= got & (int)(t==SPEED_UP) ? 1.18f : 1.f;
+      S.pw[i] = got & (int)(t==WIDE_PADDLE) ? std::min(S.pw[i]*1.35f, 320.f)
+              : got & (int)(t==SHRINK_PADDLE) ? std::max(S.pw[i]*0.7f, 60.f) : S.pw[i];
+      S.widthT[i] = got & (int)(t==WIDE_PADDLE) ? 14.f : got & (int)(t==SHRINK_PADDLE) ? 12.f : S.widthT[i];
+      S.throughT[i] = got & (int)(t==THROUGH_BALL) ? 10.f : got & (int)(t==FIREBALL) ? std::max(S.throughT[i], 8.f) : S.throughT[i];
+      S.fireT[i] = got & (int)(t==FIREBALL) ? 8.f : S.fireT[i];
+      int death = got & (int)(t==INSTANT_DEATH);
+      S.lives[i] = death ? 0 : S.lives[i];
+      S.done[i] = death ? 2 : S.done[i];
+    }
+  }
 
-  // Launch Ball
-  if(key==' ' && ball.stuck){
-    ball.stuck=false; ball.vel = normalize(Vec2{0.2f,1.f})*ball.speed; hasLaunched=true;
+  // Win check.
+  for(int i=0;i<K;i++){
+    uint64_t any = 0; for(int w=0;w<BATCH_WORDS;w++) any |= S.alive[w][i];
+    S.done[i] = (S.done[i]==0) & S.active[i] & (int)(any==0) ? 1 : S.done[i];
   }
-  // Fire Bullet
-  if(key=='f' || key=='F') fireBullet();
 }
 
-static void onSpKey(int key,int,int){
-  // Menu navigation
-  if(current==MENU){
-    int itemCount = canResume ? 5 : 4;
-    if(key==GLUT_KEY_UP){ menuIndex = (menuIndex - 1 + itemCount) % itemCount; }
-    if(key==GLUT_KEY_DOWN){ menuIndex = (menuIndex + 1) % itemCount; }
-    return;
+// Plays `games` games on K lanes, refilling a lane as soon as its game ends.
+static int runBatch(int K,int games,unsigned seed){
+  headless = true;
+  BatchSim* S = new BatchSim(); batchInit(*S, K); K = S->K;
+  int started=0, finished=0, wins=0, timeouts=0; double scoreSum=0, clearSum=0;
+  long long laneTicks=0;
+  for(int i=0;i<K;i++){
+    if(started<games) batchResetLane(*S, i, seed + 0x9E3779B9u*(uint32_t)(++started));
+    else S->done[i] = 3;   // idle lane
   }
-// Pause menu navigation
-  if(current==PAUSE){
-    if(key==GLUT_KEY_UP){ pauseMenuIndex = (pauseMenuIndex - 1 + 2) % 2; }
-    if(key==GLUT_KEY_DOWN){ pauseMenuIndex = (pauseMenuIndex + 1) % 2; }
-    return;
+  auto t0 = std::chrono::steady_clock::now();
+  while(finished < games){
+    batchStep(*S, HEADLESS_DT);
+    for(int i=0;i<K;i++){
+      if(S->done[i]==3) continue;
+      if(S->done[i]==0 && S->time[i] < HEADLESS_MAX_TIME){ ++laneTicks; continue; }
+      ++laneTicks; ++finished; scoreSum += S->score[i];
+      if(S->done[i]==1){ ++wins; clearSum += S->time[i]; } else if(S->done[i]==0) ++timeouts;
+      if(started<games) batchResetLane(*S, i, seed + 0x9E3779B9u*(uint32_t)(++started));
+      else S->done[i] = 3;
+    }
   }
-  // In gameplay, movement keys
-  if(current!=PLAY) return;
-  if(key==GLUT_KEY_LEFT) leftHeld=true;
-  if(key==GLUT_KEY_RIGHT) rightHeld=true;
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  std::printf("batch: lanes=%d games=%d wins=%d timeouts=%d mean score=%.0f mean clear time=%.1fs\n",
+              K, games, wins, timeouts, scoreSum/std::max(1,games), wins ? clearSum/wins : 0.0);
+  std::printf("batch: game-ticks=%lld wall=%.3fs game-ticks/s=%.0f games/s=%.1f\n",
+              laneTicks, wall, wall>0 ? laneTicks/wall : 0.0, wall>0 ? games/wall : 0.0);
+  heatFinish(games);
+  delete S;
+  return 0;
 }
 
-static void onSpKeyUp(int key,int,int){
-  if(key==GLUT_KEY_LEFT) leftHeld=false;
-  if(key==GLUT_KEY_RIGHT) rightHeld=false;
+// --- Observation Renderer ---
+// Pixel observations for learning agents, drawn straight from game state into
+// a caller-owned uint8 tensor: size x size (84 or 128), row 0 at the top,
+// channels planar. OBS_GRAY is one channel with each kind of object at its
+// own intensity; OBS_PLANES gives bricks (by hp), paddle, ball, perks (by
+// type) and bullets a plane each. Shapes fill the pixels whose centres they
+// cover, like the software backend, but small objects (ball, bullets) always
+// cover at least one pixel so they never vanish at low resolution. Rows are
+// cleared and filled with memset, nothing is allocated per call, and the
+// batch variant renders every lane of a BatchSim into one [K][C][S][S] block.
+enum ObsLayout { OBS_GRAY, OBS_PLANES };
+enum { OBS_P_BRICKS, OBS_P_PADDLE, OBS_P_BALL, OBS_P_PERKS, OBS_P_BULLETS, OBS_PLANE_COUNT };
+struct ObsSpec { int size; ObsLayout layout; };
+static inline int obsChannels(const ObsSpec& s){ return s.layout==OBS_GRAY ? 1 : OBS_PLANE_COUNT; }
+static inline size_t obsBytes(const ObsSpec& s){ return (size_t)s.size*s.size*obsChannels(s); }
+
+// Gray intensities: paddle and ball 255, bullets 224, bricks 192/128 by hp,
+// perks 64..176 by type.
+static inline uint8_t obsBrickValue(int hp){ return hp>=2 ? 192 : 128; }
+static inline uint8_t obsPerkValue(int type){ return (uint8_t)(64 + 16*type); }
+
+// Pixel rectangle [x0,x1) x [y0,y1) in observation rows (top-down).
+struct ObsRect { int x0, x1, y0, y1; };
+
+static inline ObsRect obsRect(int S,float wx0,float wy0,float wx1,float wy1,bool atLeastOne){
+  float sx = (float)S/scrW, sy = (float)S/scrH;
+  int x0 = (int)std::ceil(wx0*sx-0.5f), x1 = (int)std::ceil(wx1*sx-0.5f);
+  int y0 = (int)std::ceil(wy0*sy-0.5f), y1 = (int)std::ceil(wy1*sy-0.5f);   // bottom-up
+  if(atLeastOne && x1<=x0){ x0 = (int)std::floor((wx0+wx1)*0.5f*sx); x1 = x0+1; }
+  if(atLeastOne && y1<=y0){ y0 = (int)std::floor((wy0+wy1)*0.5f*sy); y1 = y0+1; }
+  ObsRect r; r.x0 = std::max(0, x0); r.x1 = std::min(S, x1);
+  r.y0 = std::max(0, S-y1); r.y1 = std::min(S, S-y0);
+  return r;
 }
 
-static void onMouse(int button,int state,int x,int y){
-  // Convert GLUT y to window coords (we use 0..scrH)
-  int wy = scrH - y;
-  if(current==MENU){
-    if(button==GLUT_LEFT_BUTTON && state==GLUT_DOWN){
-      const char* itemsResume[] = {"[ RESUME ]","[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
-      const char* itemsFresh[]  = {"[ START NEW GAME ]","[ HIGH SCORES ]","[ HELP ]","[ EXIT ]"};
-      const char** items = canResume ? itemsResume : itemsFresh;
-      int itemCount = canResume ? 5 : 4;
-      if(menuIndex>=0 && menuIndex<itemCount){
-        std::string it = items[menuIndex];
-        if(it=="[ RESUME ]" && canResume) current=PLAY;
-        else if(it=="[ START NEW GAME ]") newGame();
-        else if(it=="[ HIGH SCORES ]") current=HIGHSCORES;
-        else if(it=="[ HELP ]") current=HELP;
-        else if(it=="[ EXIT ]") std::exit(0);
+static inline void obsFill(uint8_t* plane,int S,const ObsRect& r,uint8_t v){
+  if(r.x1<=r.x0) return;
+  for(int y=r.y0;y<r.y1;y++) std::memset(plane + (size_t)y*S + r.x0, v, (size_t)(r.x1-r.x0));
+}
+
+// Where kind k is drawn: the single gray plane, or its own plane.
+static inline uint8_t* obsPlane(uint8_t* out,const ObsSpec& s,int k){ return s.layout==OBS_GRAY ? out : out + (size_t)k*s.size*s.size; }
+
+static void renderObservation(const ObsSpec& s, uint8_t* out){
+  const int S = s.size; bool gray = s.layout==OBS_GRAY;
+  std::memset(out, 0, obsBytes(s));
+  uint8_t* P = obsPlane(out, s, OBS_P_BRICKS);
+  for(size_t i=0;i<bricks.size();++i){
+    const Brick& b = bricks[i]; if(!b.alive) continue;
+    obsFill(P, S, obsRect(S, b.x-b.w/2.f, b.y-b.h/2.f, b.x+b.w/2.f, b.y+b.h/2.f, false), gray ? obsBrickValue(b.hp) : (b.hp>=2 ? 255 : 128));
+  }
+  P = obsPlane(out, s, OBS_P_PERKS);
+  for(size_t i=0;i<perks.size();++i){
+    const Perk& p = perks[i]; if(!p.alive) continue;
+    float h = p.size/2.f;
+    obsFill(P, S, obsRect(S, p.pos.x-h, p.pos.y-h, p.pos.x+h, p.pos.y+h, true), obsPerkValue(p.type));
+  }
+  P = obsPlane(out, s, OBS_P_BULLETS);
+  for(size_t i=0;i<bullets.size();++i){
+    const Bullet& u = bullets[i]; if(!u.alive) continue;
+    obsFill(P, S, obsRect(S, u.pos.x-u.w/2.f, u.pos.y-u.h/2.f, u.pos.x+u.w/2.f, u.pos.y+u.h/2.f, true), gray ? 224 : 255);
+  }
+  obsFill(obsPlane(out, s, OBS_P_PADDLE), S, obsRect(S, paddle.pos.x-paddle.w/2.f, paddle.pos.y-paddle.h/2.f,
+          paddle.pos.x+paddle.w/2.f, paddle.pos.y+paddle.h/2.f, true), 255);
+  float r = ball.radius;
+  obsFill(obsPlane(out, s, OBS_P_BALL), S, obsRect(S, ball.pos.x-r, ball.pos.y-r, ball.pos.x+r, ball.pos.y+r, true), 255);
+}
+
+// All K lanes of a batch into out[K][C][S][S]. Brick rectangles are shared by
+// every lane, so they are mapped to pixels once and each lane walks its
+// alive bitset.
+static void batchObserve(const BatchSim& B, const ObsSpec& s, uint8_t* out){
+  const int S = s.size; const size_t per = obsBytes(s); bool gray = s.layout==OBS_GRAY;
+  ObsRect kr[64*BATCH_WORDS];
+  for(int j=0;j<B.NB;j++) kr[j] = obsRect(S, B.kx0[j], B.ky0[j], B.kx1[j], B.ky1[j], false);
+  const float R = 9.f, PY = 48.f, PH = 16.f;
+  for(int i=0;i<B.K;i++){
+    uint8_t* o = out + per*i;
+    std::memset(o, 0, per);
+    uint8_t* P = obsPlane(o, s, OBS_P_BRICKS);
+    for(int w=0;w<BATCH_WORDS;w++){
+      for(uint64_t m = B.alive[w][i]; m; m &= m-1){
+        int j = w*64 + __builtin_ctzll(m); bool two = (B.hp2[w][i]>>(j%64)) & 1;
+        obsFill(P, S, kr[j], gray ? obsBrickValue(two ? 2 : 1) : (two ? 255 : 128));
       }
     }
-    return;
+    P = obsPlane(o, s, OBS_P_PERKS);
+    for(int k=0;k<BATCH_PERKS;k++){
+      if(B.pkt[k][i] < 0) continue;
+      float x = B.pkx[k][i], y = B.pky[k][i];
+      obsFill(P, S, obsRect(S, x-9.f, y-9.f, x+9.f, y+9.f, true), obsPerkValue(B.pkt[k][i]));
+    }
+    obsFill(obsPlane(o, s, OBS_P_PADDLE), S, obsRect(S, B.px[i]-B.pw[i]/2.f, PY-PH/2.f, B.px[i]+B.pw[i]/2.f, PY+PH/2.f, true), 255);
+    obsFill(obsPlane(o, s, OBS_P_BALL), S, obsRect(S, B.bx[i]-R, B.by[i]-R, B.bx[i]+R, B.by[i]+R, true), 255);
   }
+}
 
-  if(current==PAUSE){
-    if(button==GLUT_LEFT_BUTTON && state==GLUT_DOWN){
-      // Treat left-click as Enter: select highlighted option
-      if(pauseMenuIndex==0){ current=PLAY; }
-      else if(pauseMenuIndex==1){ exitToMenu(); }
+// --obs-bench SIZE [FILE.pgm]: observation throughput on a live game and on
+// a full batch, for both layouts; FILE gets the last single-game gray frame.
+static int runObsBench(int size, const std::string& dump){
+  headless = true;
+  if(size<8 || size>1024){ std::fprintf(stderr, "obs: size must be 8..1024\n"); return 1; }
+  typedef std::chrono::steady_clock clk;
+  const ObsLayout layouts[2] = {OBS_GRAY, OBS_PLANES};
+  const char* names[2] = {"gray", "planes"};
+  newGameSeeded(12345u);
+  std::vector<uint8_t> buf(obsBytes(ObsSpec{size, OBS_PLANES})), last(obsBytes(ObsSpec{size, OBS_GRAY}));
+  for(int l=0;l<2;l++){
+    ObsSpec s = {size, layouts[l]};
+    newGameSeeded(12345u); long long n=0; double sec=0.0;
+    while(n < 200000 && current==PLAY){
+      autopilot(); updateGame(HEADLESS_DT); playTime += HEADLESS_DT;
+      auto t0 = clk::now(); renderObservation(s, buf.data()); sec += std::chrono::duration<double>(clk::now()-t0).count(); ++n;
+      if(l==0 && n==3000) std::copy(buf.begin(), buf.begin()+last.size(), last.begin());
     }
-    return;
+    std::printf("obs %dx%d %-6s single game: %lld obs, %.2f us/obs, %.0f obs/s\n", size, size, names[l], n, sec*1e6/n, n/sec);
   }
-
-  if(current==PLAY){
-    if(ball.stuck && button==GLUT_LEFT_BUTTON && state==GLUT_DOWN){
-      ball.stuck=false; ball.vel = normalize(Vec2{0,1})*ball.speed;
+  BatchSim* B = new BatchSim(); batchInit(*B, BATCH_MAX);
+  for(int i=0;i<B->K;i++) batchResetLane(*B, i, 777u + 0x9E3779B9u*(uint32_t)i);
+  for(int l=0;l<2;l++){
+    ObsSpec s = {size, layouts[l]};
+    std::vector<uint8_t> tensor(obsBytes(s)*B->K);
+    long long n=0; double sec=0.0;
+    for(int t=0;t<200;t++){
+      batchStep(*B, HEADLESS_DT);
+      auto t0 = clk::now(); batchObserve(*B, s, tensor.data()); sec += std::chrono::duration<double>(clk::now()-t0).count(); n += B->K;
     }
-    if(button==GLUT_RIGHT_BUTTON && state==GLUT_DOWN){
-      fireBullet();
+    std::printf("obs %dx%d %-6s batch of %d: %.2f us/obs, %.0f obs/s\n", size, size, names[l], B->K, sec*1e6/n, n/sec);
+  }
+  delete B;
+  if(!dump.empty()){
+    FILE* f = std::fopen(dump.c_str(), "wb");
+    if(!f){ std::fprintf(stderr, "obs: cannot write %s\n", dump.c_str()); return 1; }
+    std::fprintf(f, "P5\n%d %d\n255\n", size, size); std::fwrite(last.data(), 1, last.size(), f); std::fclose(f);
+  }
+  return 0;
+}
+
+// --- Simulation Service ---
+// --serve SOCKET keeps a simulator resident for other processes. A client
+// lays a batch out in a shared-memory segment it owns (SimBatch header, then
+// SimJob[jobs], SimResult[jobs], SimEvent[events]) and sends the segment's
+// name over the Unix socket. The daemon maps it, runs the jobs across the job
+// system with one whole game per job, writes results in place and replies.
+// Only the fixed-size SimMsg crosses the socket. --submit is a reference client.
+// The client can still write the segment while the daemon works, so the header
+// and jobs are copied out once and only the validated copies are used.
+enum SimPolicy { SIM_TRACK, SIM_PREDICT, SIM_EVENTS, SIM_SCRIPT };
+enum SimStatus { SIM_OK, SIM_EBADMSG, SIM_ESHM, SIM_ELAYOUT };
+struct SimJob    { uint32_t seed, tickBudget; uint8_t rows, cols, policy, pad; uint32_t eventFirst, eventCount; };
+struct SimResult { int32_t score, lives; uint32_t ticks; float playTime; int32_t outcome; };  // outcome: WIN, GAMEOVER or PLAY (budget hit)
+struct SimEvent  { uint32_t tick, kind; float value; };  // SIM_SCRIPT input, like InputEvent
+struct SimBatch  { uint32_t magic, version, jobs, events; };
+struct SimMsg    { uint32_t magic, status, jobs; float wallSec; char shm[48]; };
+static const uint32_t SIM_MAGIC = 0x53535844u;  // "DXSS"
+
+static size_t simBatchBytes(uint32_t jobs, uint32_t events){
+  return sizeof(SimBatch) + jobs*(sizeof(SimJob)+sizeof(SimResult)) + events*sizeof(SimEvent);
+}
+
+// One game on the calling thread. rows/cols 0 mean the default layout;
+// tickBudget 0 means the headless time cap.
+static void simRun(const SimJob& j, const SimEvent* ev, SimResult& r){
+  ++jobSerial;
+  newGameSeeded(j.seed);
+  if(j.rows || j.cols) buildBricks(j.rows ? j.rows : 7, j.cols ? j.cols : 12);
+  uint32_t ticks=0, e=j.eventFirst, eEnd=j.eventFirst+j.eventCount;
+  while(current==PLAY && playTime < HEADLESS_MAX_TIME && (j.tickBudget==0 || ticks < j.tickBudget)){
+    float dt = HEADLESS_DT;
+    switch(j.policy){
+      case SIM_TRACK:   autopilot(); break;
+      case SIM_PREDICT: autopilotPredict(); break;
+      case SIM_EVENTS:  autopilotPredict(); dt = nextEventDt(); break;
+      case SIM_SCRIPT:
+        for(; e<eEnd; e++){ SimEvent x = ev[e]; if(x.tick > ticks) break; applyInput((InputKind)x.kind, x.value); }
+        break;
     }
+    updateGame(dt); playTime += dt; ++ticks;
   }
+  r.score=score; r.lives=lives; r.ticks=ticks; r.playTime=playTime; r.outcome=(int32_t)current;
+  history.clear();  // saveHighScore() entries would otherwise pile up in a long-lived daemon
+  --jobSerial;
 }
 
-static void onMotion(int x,int y){ (void)y;
-  if(current==PLAY){
-    float minX = paddle.w/2.f+6.f, maxX = scrW - paddle.w/2.f - 6.f;
-    float nx = (float)x; if(nx<minX) nx=minX; if(nx>maxX) nx=maxX;
-    paddle.pos.x = nx;
+#ifdef __linux__
+static bool simRecvAll(int fd, void* p, size_t n){
+  for(char* c=(char*)p; n>0; ){ ssize_t k = recv(fd, c, n, 0); if(k<0 && errno==EINTR) continue; if(k<=0) return false; c+=k; n-=(size_t)k; }
+  return true;
+}
+static bool simSendAll(int fd, const void* p, size_t n){
+  for(const char* c=(const char*)p; n>0; ){ ssize_t k = send(fd, c, n, MSG_NOSIGNAL); if(k<0 && errno==EINTR) continue; if(k<=0) return false; c+=k; n-=(size_t)k; }
+  return true;
+}
+
+static SimMsg simServeBatch(const SimMsg& m){
+  SimMsg r; std::memset(&r, 0, sizeof(r)); r.magic = SIM_MAGIC; std::memcpy(r.shm, m.shm, sizeof(r.shm));
+  if(m.magic != SIM_MAGIC || !std::memchr(m.shm, 0, sizeof(m.shm))){ r.status = SIM_EBADMSG; return r; }
+  int fd = shm_open(m.shm, O_RDWR, 0); struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SimBatch)){ if(fd>=0) close(fd); r.status = SIM_ESHM; return r; }
+  size_t bytes = (size_t)st.st_size;
+  void* p = mmap(nullptr, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0); close(fd);
+  if(p == MAP_FAILED){ r.status = SIM_ESHM; return r; }
+  SimBatch B; std::memcpy(&B, p, sizeof(B));
+  bool ok = B.magic==SIM_MAGIC && B.version==1 && B.jobs <= (1u<<24) && B.events <= (1u<<28) && simBatchBytes(B.jobs, B.events) <= bytes;
+  std::vector<SimJob> J;
+  if(ok){ J.resize(B.jobs); if(B.jobs) std::memcpy(J.data(), (const SimBatch*)p + 1, B.jobs*sizeof(SimJob)); }
+  SimResult* R = ok ? (SimResult*)((SimJob*)((SimBatch*)p + 1) + B.jobs) : nullptr;
+  const SimEvent* E = ok ? (const SimEvent*)(R + B.jobs) : nullptr;
+  for(uint32_t i=0; ok && i<B.jobs; i++){
+    const SimJob& j = J[i];   // rows/cols 0 select the default layout
+    ok = j.policy <= SIM_SCRIPT && j.rows <= LEVEL_MAX_ROWS && j.cols <= LEVEL_MAX_COLS &&
+         j.eventFirst <= B.events && j.eventCount <= B.events - j.eventFirst;
   }
+  if(ok){
+    auto t0 = std::chrono::steady_clock::now();
+    const SimJob* JP = J.data();
+    parallelFor((int)B.jobs, 1, [JP,R,E](int b,int e){ for(int i=b;i<e;i++) simRun(JP[i], E, R[i]); });
+    r.jobs = B.jobs;
+    r.wallSec = std::chrono::duration<float>(std::chrono::steady_clock::now()-t0).count();
+  } else r.status = SIM_ELAYOUT;
+  munmap(p, bytes);
+  return r;
+}
+
+static void simConnection(int c){
+  SimMsg m;
+  while(simRecvAll(c, &m, sizeof(m))){ SimMsg r = simServeBatch(m); if(!simSendAll(c, &r, sizeof(r))) break; }
+  close(c);
+}
+
+static int simSocket(const std::string& path, sockaddr_un& a){
+  if(path.size() >= sizeof(a.sun_path)){ std::fprintf(stderr, "socket path too long: %s\n", path.c_str()); return -1; }
+  std::memset(&a, 0, sizeof(a)); a.sun_family = AF_UNIX; std::strcpy(a.sun_path, path.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0); if(fd < 0) std::perror("socket");
+  return fd;
+}
+#endif
+
+// Daemon: one thread per client connection; batches run on the job workers.
+static int runServe(const std::string& path){
+#ifdef __linux__
+  headless = true;
+  sockaddr_un a; int fd = simSocket(path, a); if(fd < 0) return 1;
+  unlink(path.c_str());
+  if(bind(fd, (sockaddr*)&a, sizeof(a)) != 0 || listen(fd, 16) != 0){ std::perror("serve"); close(fd); return 1; }
+  std::printf("serve: listening on %s (%d workers)\n", path.c_str(), jobWorkers); std::fflush(stdout);
+  for(;;){
+    int c = accept(fd, nullptr, nullptr);
+    if(c < 0){ if(errno==EINTR) continue; std::perror("accept"); break; }
+    std::thread(simConnection, c).detach();
+  }
+  close(fd); unlink(path.c_str());
+  return 1;
+#else
+  std::fprintf(stderr, "--serve: only supported on Linux\n"); (void)path;
+  return 1;
+#endif
+}
+
+// Reference client: N games seeded seed, seed+1, ... under one policy.
+static int runSubmit(const std::string& path, int n, unsigned seed, int policy){
+#ifdef __linux__
+  if(n <= 0) return 0;
+  char name[48]; std::snprintf(name, sizeof(name), "/dxsim-%d", (int)getpid());
+  size_t bytes = simBatchBytes((uint32_t)n, 0);
+  int sfd = shm_open(name, O_CREAT|O_EXCL|O_RDWR, 0600);
+  if(sfd < 0 || ftruncate(sfd, (off_t)bytes) != 0){ std::perror("shm"); if(sfd>=0){ close(sfd); shm_unlink(name); } return 1; }
+  void* p = mmap(nullptr, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, sfd, 0); close(sfd);
+  if(p == MAP_FAILED){ std::perror("mmap"); shm_unlink(name); return 1; }
+  SimBatch* B = (SimBatch*)p; B->magic = SIM_MAGIC; B->version = 1; B->jobs = (uint32_t)n; B->events = 0;
+  SimJob* J = (SimJob*)(B+1); SimResult* R = (SimResult*)(J+n);
+  for(int i=0;i<n;i++){ std::memset(&J[i], 0, sizeof(SimJob)); J[i].seed = seed + (unsigned)i; J[i].policy = (uint8_t)policy; }
+  sockaddr_un a; int fd = simSocket(path, a); int rc = 1;
+  SimMsg m; std::memset(&m, 0, sizeof(m)); m.magic = SIM_MAGIC; m.jobs = (uint32_t)n; std::strcpy(m.shm, name);
+  if(fd >= 0 && connect(fd, (sockaddr*)&a, sizeof(a)) == 0 && simSendAll(fd, &m, sizeof(m)) && simRecvAll(fd, &m, sizeof(m))){
+    if(m.status == SIM_OK){
+      int wins=0; long long ticks=0;
+      for(int i=0;i<n;i++){
+        std::printf("job %d: seed=%u %s score=%d lives=%d ticks=%u time=%.1fs\n", i, J[i].seed,
+                    R[i].outcome==WIN ? "WIN" : R[i].outcome==GAMEOVER ? "GAMEOVER" : "BUDGET", R[i].score, R[i].lives, R[i].ticks, R[i].playTime);
+        wins += R[i].outcome==WIN; ticks += R[i].ticks;
+      }
+      std::printf("summary: jobs=%d wins=%d ticks=%lld server wall=%.3fs\n", n, wins, ticks, m.wallSec);
+      rc = 0;
+    } else std::fprintf(stderr, "submit: server returned status %u\n", m.status);
+  } else std::perror("submit");
+  if(fd >= 0) close(fd);
+  munmap(p, bytes); shm_unlink(name);
+  return rc;
+#else
+  std::fprintf(stderr, "--submit: only supported on Linux\n"); (void)path; (void)n; (void)seed; (void)policy;
+  return 1;
+#endif
 }
-static void onPassiveMotion(int x,int y){ onMotion(x,y); }
 
 int main(int argc,char** argv){
+  int headlessGames=0, batchLanes=0; unsigned seed=(unsigned)time(nullptr); bool seedGiven=false;
+  bool bench=false, soft=false, predict=false, events=false; std::string baseline, saveBaseline, servePath; std::vector<std::string> positional;
+  int submitJobs=0; std::string thumbsPack, thumbsOut; bool term=false, watch=false, verify=false; int obsSize=0, solveBeam=0, arenaGames=0, tourneyGames=0;
+  std::string policyFile; bool bracket=false;
+  std::string tuneGroup, checkpoint; int tuneGens=30, tuneGames=200, tunePop=0; float tuneTime=180.f, tuneRate=0.3f;
+  for(int i=1;i<argc;i++){
+    if(!std::strcmp(argv[i],"--perf")) perfInit();
+    else if(!std::strcmp(argv[i],"--headless") && i+1<argc){ headless=true; headlessGames=std::atoi(argv[++i]); }
+    else if(!std::strcmp(argv[i],"--seed") && i+1<argc){ seed=(unsigned)std::strtoul(argv[++i],nullptr,10); seedGiven=true; }
+    else if(!std::strcmp(argv[i],"--record") && i+1<argc) recordDir=argv[++i];
+    else if(!std::strcmp(argv[i],"--bench")) bench=true;
+    else if(!std::strcmp(argv[i],"--heatmap") && i+1<argc){ heatOn=true; heatPrefix=argv[++i]; }
+    else if(!std::strcmp(argv[i],"--verify")) verify=true;
+    else if(!std::strcmp(argv[i],"--batch") && i+1<argc) batchLanes=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--log") && i+1<argc) logStart(argv[++i]);
+    else if(!std::strcmp(argv[i],"--jobs") && i+1<argc) jobInit(std::atoi(argv[++i]));
+    else if(!std::strcmp(argv[i],"--soft")) soft=true;
+    else if(!std::strcmp(argv[i],"--policy") && i+1<argc) predict = !std::strcmp(argv[++i],"predict");
+    else if(!std::strcmp(argv[i],"--events")) events=true;
+    else if(!std::strcmp(argv[i],"--shm") && i+1<argc){ if(!metricsStart(argv[++i])) return 1; }
+    else if(!std::strcmp(argv[i],"--monitor") && i+1<argc) return runMonitor(argv[++i]);
+    else if(!std::strcmp(argv[i],"--serve") && i+1<argc) servePath=argv[++i];
+    else if(!std::strcmp(argv[i],"--trace") && i+1<argc){ if(!traceStart(argv[++i])) return 1; }
+    else if(!std::strcmp(argv[i],"--trace-dump") && i+1<argc) return runTraceDump(argv[++i]);
+    else if(!std::strcmp(argv[i],"--submit") && i+2<argc){ servePath=argv[++i]; submitJobs=std::atoi(argv[++i]); }
+    else if(!std::strcmp(argv[i],"--pack") && i+1<argc){ if(!loadLevelPack(argv[++i], levelPack)) return 1; levelIndex=0; }
+    else if(!std::strcmp(argv[i],"--atlas") && i+1<argc){
+      if(!loadThumbAtlas(argv[++i], thumbAtlas)){ std::fprintf(stderr, "atlas: cannot read %s.ppm/.idx\n", argv[i]); return 1; }
+    }
+    else if(!std::strcmp(argv[i],"--thumbs") && i+2<argc){ thumbsPack=argv[++i]; thumbsOut=argv[++i]; }
+    else if(!std::strcmp(argv[i],"--obs-bench") && i+1<argc) obsSize=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--solve") && i+1<argc) solveBeam=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--arena") && i+1<argc) arenaGames=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--tourney") && i+1<argc) tourneyGames=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--policies") && i+1<argc) policyFile=argv[++i];
+    else if(!std::strcmp(argv[i],"--bracket")) bracket=true;
+    else if(!std::strcmp(argv[i],"--tune") && i+1<argc) tuneGroup=argv[++i];
+    else if(!std::strcmp(argv[i],"--generations") && i+1<argc) tuneGens=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--tune-games") && i+1<argc) tuneGames=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--tune-pop") && i+1<argc) tunePop=std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--tune-target") && i+1<argc) std::sscanf(argv[++i], "%f,%f", &tuneTime, &tuneRate);
+    else if(!std::strcmp(argv[i],"--checkpoint") && i+1<argc) checkpoint=argv[++i];
+    else if(!std::strcmp(argv[i],"--check") && i+1<argc) checkStart(std::atoi(argv[++i]));
+    else if(!std::strcmp(argv[i],"--slow-rate") && i+1<argc) slowRate=clampv(std::atoi(argv[++i]), 1, 16);
+    else if(!std::strcmp(argv[i],"--term")) term=true;
+    else if(!std::strcmp(argv[i],"--watch")) watch=true;
+    else if(!std::strcmp(argv[i],"--no-brick-cache")) brickCache=false;
+    else if(!std::strcmp(argv[i],"--baseline") && i+1<argc) baseline=argv[++i];
+    else if(!std::strcmp(argv[i],"--save-baseline") && i+1<argc) saveBaseline=argv[++i];
+    else if(argv[i][0]!='-') positional.push_back(argv[i]);
+  }
+  if(!thumbsPack.empty()) return runThumbs(thumbsPack, thumbsOut);
+  if(obsSize>0) return runObsBench(obsSize, positional.empty() ? std::string() : positional[0]);
+  if(!levelPack.empty() && !thumbAtlas.x.empty() && thumbAtlas.x.size()!=levelPack.size()){
+    std::fprintf(stderr, "atlas: %d thumbnails for %d levels, ignoring it\n", (int)thumbAtlas.x.size(), (int)levelPack.size());
+    thumbAtlas = ThumbAtlas();
+  }
+  if(solveBeam>0) return runSolve(solveBeam, seedGiven ? seed : SOLVE_SEED);
+  if(verify) return runVerify(positional);
+  if(tourneyGames>0) return runTourney(tourneyGames, seed, policyFile, bracket);
+  if(!tuneGroup.empty()) return runTune(tuneGroup, tuneGens, tuneGames, tunePop, tuneTime, tuneRate, seed, checkpoint);
+  if(arenaGames>0 && headless) return runArenaBench(arenaGames, headlessGames, seed, soft);
+  if(bench){ backend = soft ? BACKEND_SOFT : BACKEND_NULL; return runBench(positional, baseline, saveBaseline); }
+  if(submitJobs>0) return runSubmit(servePath, submitJobs, seed, events ? SIM_EVENTS : predict ? SIM_PREDICT : SIM_TRACK);
+  if(!servePath.empty()) return runServe(servePath);
+  if(batchLanes>0) return runBatch(batchLanes, headlessGames>0 ? headlessGames : batchLanes, seed);
+  if(term){ rng.seed(seed); return runTerm(watch, predict); }
+  if(headless) return runHeadless(headlessGames, seed, predict, events);
+
   glutInit(&argc, argv);
   glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
   glutInitWindowSize(scrW, scrH);
   glutCreateWindow("DX-Ball - OpenGL GLUT [Modern Edition]");
   glDisable(GL_DEPTH_TEST);
 
+  if(arenaGames>0){
+    arenaInit(arenaGames, seed, scrW, scrH);
+    glutDisplayFunc(onArenaDisplay); glutIdleFunc(onArenaIdle);
+    glutReshapeFunc(onArenaReshape); glutKeyboardFunc(onArenaKey);
+    glutMainLoop();
+    return 0;
+  }
+
   glutDisplayFunc(onDisplay);
   glutIdleFunc(onIdle);
   glutReshapeFunc(onReshape);
@@ -688,7 +5062,7 @@ int main(int argc,char** argv){
   glutMotionFunc(onMotion);
   glutPassiveMotionFunc(onPassiveMotion);
 
-  rng.seed((unsigned)time(nullptr));
+  rng.seed(seed);
   loadBest();
 
   menuIndex = 0; canResume = false; pauseMenuIndex = 0;